@@ -11,18 +11,39 @@ if ($inCI) {
     . "$emsdkPath\emsdk_env.ps1"
 }
 
+# Headless game rules, built into a static library first and linked into the game
+$coreFiles = @("AiPlayer.c", "AutoRepeat.c", "BoardFeatures.c", "Clock.c", "DynamicArray.c", "GameBatch.c", "GameCore.c", "GameSnapshot.c", "Grid.c", "InputQueue.c", "MoveGen.c", "Piece.c", "PiecePool.c", "PieceQueue.c", "Random.c", "Replay.c", "ReplayVerifier.c", "TranspositionTable.c")
+
 # Define directories
-$sourceFiles = Get-ChildItem -Path "source" -Filter "*.c" | ForEach-Object { $_.FullName }
+$sourceFiles = Get-ChildItem -Path "source" -Filter "*.c" | Where-Object { $coreFiles -notcontains $_.Name } | ForEach-Object { $_.FullName }
+$coreSourceFiles = $coreFiles | ForEach-Object { Join-Path "source" $_ }
 $outputDir = "emcc_build"
+$coreOutputDir = "$outputDir\core"
+$coreLibrary = "$outputDir\libfallingbricks_core.a"
 $outputFile = "$outputDir\index.html"
 
-# Create the output directory if it doesn't exist
+# Create the output directories if they don't exist
 if (!(Test-Path $outputDir)) {
     New-Item -ItemType Directory -Path $outputDir
 }
+if (!(Test-Path $coreOutputDir)) {
+    New-Item -ItemType Directory -Path $coreOutputDir
+}
+
+# Compile the core without linking, it only needs SDL's headers for its types. -msimd128 lets board evaluation use WASM SIMD.
+$coreObjects = @()
+foreach ($coreSource in $coreSourceFiles) {
+    $coreObject = Join-Path $coreOutputDir ([System.IO.Path]::GetFileNameWithoutExtension($coreSource) + ".o")
+    emcc -c $coreSource -o $coreObject -s USE_SDL=2 -Iinclude -O2 -msimd128 -Wno-incompatible-pointer-types
+    $coreObjects += $coreObject
+}
+if (Test-Path $coreLibrary) {
+    Remove-Item $coreLibrary
+}
+emar rcs $coreLibrary $coreObjects
 
 # Run the emcc command to compile to WebAssembly
-emcc $sourceFiles -o $outputFile `
+emcc $sourceFiles $coreLibrary -o $outputFile `
     -s USE_SDL=2 `
     -s USE_SDL_TTF=2 `
     -s USE_SDL_MIXER=2 `
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <SDL.h>
+#include <stdbool.h>
+#include "BoardFeatures.h"
+#include "Clock.h"
+#include "GameCore.h"
+#include "MoveGen.h"
+#include "TranspositionTable.h"
+
+// A computer player that drives a game through the same GameInputs a keyboard does, so it can play any mode.
+// When a piece spawns it runs a beam search over the current piece and the preview: every placement of each piece
+// is played out on a copy of the board, including row clears and the gravity combos that follow them, and only the
+// best beam_width boards are kept for the next piece. Boards reached by more than one line of play are kept once.
+// Nodes of each depth are shared out across worker threads.
+// Then it walks the piece to the chosen placement one input per step.
+
+#define AI_DEFAULT_BEAM_WIDTH 32
+#define AI_DEFAULT_TIME_BUDGET 30 // ms
+#define AI_EVAL_BATCH 16 // Children measured together by get_board_features
+#define AI_SEEN_TABLE_BITS 16 // 2^16 entries for spotting repeated boards
+
+struct AiPlayer;
+
+typedef struct {
+	int beam_width; // Boards kept at each depth
+	int search_depth; // Pieces searched, the current one plus this many minus one from the preview
+	Uint32 time_budget; // ms a search may take. Depths that don't finish in time are dropped, the first always finishes.
+	Uint32 input_delay; // Minimum game time in ms between inputs, 0 gives one input every step
+	int thread_count; // 0 uses one thread per CPU
+	// Times the budget, NULL for real time. A virtual clock nobody advances never runs out, so searches come out the
+	// same on any machine. It has to outlive the player.
+	const Clock* clock;
+} AiSettings;
+
+// One candidate placement, or a board kept in the beam
+typedef struct {
+	int parent; // Board in the previous depth it was played on
+	Placement placement;
+	Placement first; // Placement of the current piece this line of play started with
+	float reward; // Line clears along the way
+	float value; // reward plus how good the resulting board looks
+} AiNode;
+
+// Boards the search works on. Only locked cells matter, each tagged with the piece it belongs to so gravity moves
+// pieces as a whole like drop_all_pieces does.
+typedef struct {
+	Uint64* bits; // row_words per row, like Grid row_bits
+	Uint32* ids; // width * height, 0 for empty cells
+	Uint32 next_id;
+	Uint64 hash; // Zobrist hash of the set cells, matches Grid board_hash for the same cells
+} AiBoard;
+
+typedef struct {
+	struct AiPlayer* ai;
+	SDL_Thread* thread; // NULL for the first worker, which is the thread calling get_ai_inputs
+	SDL_sem* start;
+	MoveGenerator* generator;
+	Grid* scratch_grid; // Holds the bits of the board being searched, for the move generator
+	AiBoard batch[AI_EVAL_BATCH]; // Children waiting to be measured
+	AiNode batch_nodes[AI_EVAL_BATCH];
+	const Uint64* batch_bits[AI_EVAL_BATCH];
+	BoardFeatures batch_features[AI_EVAL_BATCH];
+	int batch_count;
+	int* labels; // Scratch for gravity, one per cell
+	int* unit_cells; // Cells of each falling unit, grouped by unit
+	int* unit_start;
+	int* stack;
+	AiNode* best; // Heap of the best beam_width children found, worst on top
+	int best_count;
+	int first_node;
+	int end_node;
+	bool timed_out;
+} AiWorker;
+
+typedef struct AiPlayer {
+	AiSettings settings;
+	int width;
+	int height;
+	int row_words;
+	AiWorker* workers;
+	int worker_count;
+	SDL_sem* done;
+	bool quit;
+	AiBoard* boards[2]; // Beam boards of the depth being expanded and the one being filled
+	AiNode* nodes[2];
+	int node_count[2];
+	AiNode* merged; // Every worker's best children, before picking the beam
+	TranspositionTable* seen; // Boards already in a beam, keyed by board hash and depth, holding the search number
+	int expand_depth; // Depth in progress, 0 places the piece in play
+	enum PieceType expand_type; // Piece being placed at that depth
+	const Piece* expand_piece; // The piece in play when expanding depth 0, searched from where it is rather than from spawn
+	const AiBoard* expand_boards;
+	const AiNode* expand_nodes;
+	Clock real_clock; // Used when the settings don't give a clock
+	const Clock* clock;
+	Uint64 deadline; // Time on clock the search must stop at
+	bool has_target; // A placement has been picked for the current piece
+	Placement target;
+	Uint32 last_input_time;
+	Uint64 searches;
+	Uint64 nodes_searched;
+} AiPlayer;
+
+AiSettings get_default_ai_settings();
+
+/// <summary>
+/// Creates a player for boards of the given size. settings can be NULL for the defaults.
+/// </summary>
+AiPlayer* create_ai_player(int board_width, int board_height, const AiSettings* settings);
+
+/// <summary>
+/// Fills inputs with what the player does in the game's next step. Searches when a new piece has spawned, which can
+/// take up to the time budget. Inputs are left alone unless the game is playing.
+/// </summary>
+void get_ai_inputs(AiPlayer* ai, GameCore* game, GameInputs* inputs);
+
+void destroy_ai_player(AiPlayer* ai);
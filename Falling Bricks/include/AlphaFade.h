@@ -1,4 +1,4 @@
 #pragma once
 #include <SDL.h>
 
-Uint8 get_fade_alpha(Uint32 start_time, Uint32 duration);
\ No newline at end of file
+Uint8 get_fade_alpha(Uint32 start_time, Uint32 duration, Uint32 now);
\ No newline at end of file
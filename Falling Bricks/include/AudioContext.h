@@ -1,6 +1,7 @@
 #pragma once
 #include <SDL_mixer.h>
 #include <stdbool.h>
+#include "Random.h"
 
 #define NUM_SONGS 5
 
@@ -19,9 +20,10 @@ typedef struct {
 	Mix_Chunk* game_over;
 	bool music_paused;
 	bool sound_enabled;
+	Random random; // Picks the next song
 } AudioContext;
 
-bool create_audio_context();
+bool create_audio_context(Uint64 seed);
 
 AudioContext* get_audio_context();
 
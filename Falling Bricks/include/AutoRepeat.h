@@ -0,0 +1,55 @@
+#pragma once
+
+#include <SDL.h>
+#include <stdbool.h>
+#include "GameCore.h"
+
+// Held key repeat for moving and soft dropping, worked out from when the keys went down and up rather than from the
+// keyboard's own repeat. A held direction moves once when pressed, again after the delayed auto shift (DAS) and then
+// once every auto repeat rate (ARR) ms, each repeat falling in the tick of the moment it is due. An ARR of 0 moves
+// straight to the wall. Holding both directions moves the way pressed last. A held soft drop moves down soft_drop_factor
+// times as fast as gravity.
+// Times are in us on whatever clock the key times came from.
+
+#define AUTO_REPEAT_DEFAULT_DAS 167 // ms, ten frames at 60 FPS
+#define AUTO_REPEAT_DEFAULT_ARR 33 // ms, two frames at 60 FPS
+#define AUTO_REPEAT_DEFAULT_SOFT_DROP_FACTOR 20
+
+typedef struct {
+	Uint32 das; // ms a direction is held before it repeats
+	Uint32 arr; // ms between repeats, 0 for straight to the wall
+	Uint32 soft_drop_factor; // How many times as fast as gravity a held soft drop falls
+} AutoRepeatSettings;
+
+typedef struct {
+	AutoRepeatSettings settings;
+	bool left_held;
+	bool right_held;
+	bool down_held;
+	int direction; // -1 left, 1 right, 0 when neither is held
+	Uint64 next_shift; // When the held direction next repeats
+	Uint64 last_drop; // When the held soft drop last moved down
+} AutoRepeat;
+
+AutoRepeatSettings get_default_auto_repeat_settings();
+
+void init_auto_repeat(AutoRepeat* repeat, const AutoRepeatSettings* settings);
+
+/// <summary>
+/// Starts repeating the movement keys in inputs from time, the moment they went down. The first move is the key press
+/// itself, so this only schedules the ones after it.
+/// </summary>
+void press_auto_repeat_keys(AutoRepeat* repeat, const GameInputs* inputs, Uint64 time);
+
+/// <summary>
+/// Stops repeating the movement keys in inputs from time. If the other direction is still held it takes over, waiting
+/// out the DAS again.
+/// </summary>
+void release_auto_repeat_keys(AutoRepeat* repeat, const GameInputs* inputs, Uint64 time);
+
+/// <summary>
+/// Counts the moves due before time and moves the schedule past them. drop_delay is the game's current gravity in ms.
+/// Moves beyond max_moves, which the board's size is plenty for, are left out. With an ARR of 0 the sideways moves are
+/// all one move to the wall, set in *to_wall.
+/// </summary>
+void take_auto_repeats(AutoRepeat* repeat, Uint64 time, Uint32 drop_delay, int max_moves, int* shifts, int* drops, bool* to_wall);
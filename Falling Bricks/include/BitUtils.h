@@ -0,0 +1,57 @@
+#pragma once
+#include <SDL.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Index of the lowest set bit. bits must not be 0.
+static inline int count_trailing_zeros(Uint64 bits) {
+#if defined(_MSC_VER) && defined(_M_X64)
+	unsigned long index;
+	_BitScanForward64(&index, bits);
+	return (int)index;
+#elif defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctzll(bits);
+#else
+	int index = 0;
+	while (!(bits & 1)) {
+		bits >>= 1;
+		index++;
+	}
+	return index;
+#endif
+}
+
+// Index of the highest set bit. bits must not be 0.
+static inline int find_highest_bit(Uint64 bits) {
+#if defined(_MSC_VER) && defined(_M_X64)
+	unsigned long index;
+	_BitScanReverse64(&index, bits);
+	return (int)index;
+#elif defined(__GNUC__) || defined(__clang__)
+	return 63 - __builtin_clzll(bits);
+#else
+	int index = 0;
+	while (bits >>= 1) {
+		index++;
+	}
+	return index;
+#endif
+}
+
+// Number of set bits
+static inline int count_set_bits(Uint64 bits) {
+#if defined(_MSC_VER) && defined(_M_X64)
+	return (int)__popcnt64(bits);
+#elif defined(__GNUC__) || defined(__clang__)
+	return __builtin_popcountll(bits);
+#else
+	int count = 0;
+	while (bits) {
+		bits &= bits - 1;
+		count++;
+	}
+	return count;
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <SDL.h>
+
+// Board measurements used to judge how good a position is, read straight from packed rows laid out like Grid row_bits.
+// Boards up to 64 cells wide are measured several at a time with SIMD: AVX2 when the compiler targets it
+// (-mavx2 or /arch:AVX2), otherwise SSE2 on x86-64 and WASM SIMD in web builds (-msimd128). Wider boards and other
+// targets take a plain 64-bit path.
+
+typedef struct {
+	int aggregate_height; // Sum of column heights
+	int max_height; // Height of the tallest column
+	int holes; // Empty cells with a filled cell anywhere above them
+	int bumpiness; // Sum of height differences between neighbouring columns
+	int row_transitions; // Changes between filled and empty along each row, the walls count as filled
+	int column_transitions; // Changes between filled and empty down each column, the floor counts as filled
+	int well_depth; // Open cells with both neighbours filled (or a wall), summed over every column
+} BoardFeatures;
+
+/// <summary>
+/// Measures count boards of the given size in one call. boards[i] points at the first row of board i, each row being
+/// GRID_ROW_WORDS(width) words, and its results go to features[i].
+/// </summary>
+void get_board_features(const Uint64* const* boards, int count, int width, int height, BoardFeatures* features);
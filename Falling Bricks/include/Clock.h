@@ -0,0 +1,46 @@
+#pragma once
+#include <SDL.h>
+#include <stdbool.h>
+
+// A time source that code reads instead of calling SDL's timers, so it can be handed a different one. Times are
+// microseconds on 64 bits, which don't wrap for half a million years.
+// A real clock follows SDL's performance counter. A virtual clock only moves when advance_clock is called, for replays
+// and for tests that should run as fast as the CPU allows. A scaled clock runs some whole number of times as fast as
+// real time, for fast forwarding.
+
+typedef enum {
+	CLOCK_REAL,
+	CLOCK_VIRTUAL,
+	CLOCK_SCALED
+} ClockType;
+
+typedef struct {
+	ClockType type;
+	Uint64 origin; // Performance counter value at base, unused by virtual clocks
+	Uint64 base; // Time at origin, or the current time of a virtual clock
+	Uint32 scale;
+} Clock;
+
+// Real and scaled clocks start at 0 when created
+void init_real_clock(Clock* clock);
+
+void init_virtual_clock(Clock* clock, Uint64 start);
+
+void init_scaled_clock(Clock* clock, Uint32 scale);
+
+/// <summary>
+/// Current time in microseconds. Safe to call from any thread, as long as a virtual clock isn't being advanced meanwhile.
+/// </summary>
+Uint64 get_clock_time(const Clock* clock);
+
+Uint64 get_clock_ms(const Clock* clock);
+
+/// <summary>
+/// Moves a virtual clock forward. Other clocks follow real time and can't be moved.
+/// </summary>
+bool advance_clock(Clock* clock, Uint64 microseconds);
+
+/// <summary>
+/// Changes how fast a scaled clock runs from now on. Time already passed keeps the scale it passed at.
+/// </summary>
+void set_clock_scale(Clock* clock, Uint32 scale);
@@ -3,18 +3,30 @@
 #define WINDOW_WIDTH 1280
 #define WINDOW_HEIGHT 720
 
-#define FPS 60
+#define FPS 60 // Frame cap for displays that can't sync presents to their refresh
 #define FRAME_TARGET_TIME (1000 / FPS)
 
+#define GAME_TICK_RATE 250 // Game steps per second, the same however fast frames are drawn
+#define GAME_TICK_TIME (1000 / GAME_TICK_RATE) // 4 ms, so every game timer runs out on a whole tick
+#define MAX_TICKS_PER_FRAME 25 // Time past this (100 ms) in one frame is dropped rather than caught up on
+
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
 
 #define LABEL_DEFAULT_FONT_SIZE 40
 #define LABEL_DEFAULT_SMALL_FONT_SIZE 30
 
-#define BOARD_WIDTH 10
+#define BOARD_WIDTH 10 // Default board, other sizes can be picked with --board WxH
 #define BOARD_HEIGHT 20
+#define MIN_BOARD_WIDTH 4
+#define MIN_BOARD_HEIGHT 8
+#define MAX_BOARD_WIDTH 256
+#define MAX_BOARD_HEIGHT 1024
 #define CELL_SIZE 32
+#define MAX_BOARD_PIXEL_WIDTH 640 // Larger boards get smaller cells so they fit in this area
+#define MAX_BOARD_PIXEL_HEIGHT (BOARD_HEIGHT * CELL_SIZE)
+#define PREVIEW_LENGTH 6 // Upcoming pieces shown next to the board
+#define REPLAY_FAST_FORWARD_SPEED 10 // Times as fast as recorded while fast forwarding a replay
 
 #define BLITZ_TIME 120000 // 2 minutes
 
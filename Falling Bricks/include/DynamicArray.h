@@ -6,11 +6,22 @@ typedef struct {
     int size;        // Current number of elements
     int capacity;    // Max capacity before resizing
     void (*data_destroyer)(void*);
+    bool unordered;  // Removal moves the last item into the gap instead of shifting everything left
+    void** index_items; // Optional open addressing table of items for O(1) lookups, NULL when not indexed
+    int* index_positions; // Position in items of each entry in index_items
+    int index_capacity; // Power of two, kept at least twice the capacity
 } DynamicArray;
 
 DynamicArray* create_dynamic_array(int initial_capacity, void (*data_destroyer)(void*));
 
-void add_to_dynamic_array(DynamicArray* array, void* item);
+/// <summary>
+/// Creates an array with a hash index so contains and remove don't scan. Items must be unique.
+/// Removal is O(1) only when unordered is set, otherwise the shifted items still have to be reindexed.
+/// </summary>
+DynamicArray* create_indexed_dynamic_array(int initial_capacity, void (*data_destroyer)(void*), bool unordered);
+
+// False if the array couldn't grow, in which case it is left as it was and the item still belongs to the caller
+bool add_to_dynamic_array(DynamicArray* array, void* item);
 
 void remove_from_dynamic_array(DynamicArray* array, void* item);
 
@@ -18,6 +29,12 @@ void* get_from_dynamic_array(const DynamicArray* array, int index);
 
 void clear_dynamic_array(DynamicArray* array);
 
+/// <summary>
+/// Empties the array without destroying its items. Only the items held are removed from the index rather than the
+/// whole table being wiped, so it stays cheap when a large array holds few items.
+/// </summary>
+void empty_dynamic_array(DynamicArray* array);
+
 bool dynamic_array_contains(const DynamicArray* array, const void* item);
 
 void destroy_dynamic_array(DynamicArray* array);
\ No newline at end of file
@@ -3,6 +3,32 @@
 #include<stdbool.h>
 #include<SDL.h>
 
+bool set_board_size(int width, int height);
+
+void set_game_seed(Uint64 seed);
+
+void set_bag_randomizer(bool enabled);
+
+// The computer plays while enabled. A toggles it in game.
+void set_ai_enabled(bool enabled);
+
+// Held movement keys repeat after delay ms (DAS), then every rate ms (ARR), 0 moving straight to the wall
+void set_auto_repeat_delay(int delay);
+
+void set_auto_repeat_rate(int rate);
+
+// A held soft drop falls this many times as fast as gravity
+void set_soft_drop_factor(int factor);
+
+// Records every game to a file in directory, named after the game's seed. Takes effect when setup runs.
+void set_record_directory(const char* directory);
+
+// Watches the recorded game in path instead of playing. F fast forwards.
+bool set_replay_file(const char* path);
+
+// How many times as fast as it was recorded a replay plays
+void set_replay_speed(int speed);
+
 bool setup();
 
 void cleanup();
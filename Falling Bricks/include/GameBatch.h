@@ -0,0 +1,55 @@
+#pragma once
+
+#include <SDL.h>
+#include <stdbool.h>
+#include "GameCore.h"
+
+// Many independent games stepped together, split across a pool of worker threads. Games that end are restarted in the
+// same mode, without a countdown, on their next step so a batch can run for as long as it is stepped.
+
+struct GameBatch;
+
+typedef struct {
+	struct GameBatch* batch;
+	SDL_Thread* thread; // NULL for the first worker, which is the thread calling step_game_batch
+	SDL_sem* start; // Posted once per step
+	int first_game;
+	int end_game; // One past the last game this worker steps
+	Uint64 steps;
+	Uint64 placements;
+	Uint64 games_finished;
+} BatchWorker;
+
+typedef struct GameBatch {
+	GameCore* games; // count games side by side
+	Uint32* events; // GAME_EVENT_ flags from each game's last step
+	int count;
+	GameMode mode;
+	BatchWorker* workers;
+	int worker_count;
+	SDL_sem* done; // Posted by each worker thread when its games have stepped
+	const GameInputs* inputs; // Step in progress, one per game or NULL
+	Uint32 dt;
+	bool quit;
+} GameBatch;
+
+/// <summary>
+/// Creates count games on boards of the given size and starts them. Game i is seeded with seed + i and deals its pieces with randomizer.
+/// A thread_count of 0 uses one thread per CPU.
+/// </summary>
+GameBatch* create_game_batch(int count, int board_width, int board_height, GameMode mode, Uint64 seed, PieceRandomizer randomizer, int thread_count);
+
+/// <summary>
+/// Steps every game by dt milliseconds and returns once all of them are done. inputs holds one entry per game, or is NULL for none.
+/// </summary>
+void step_game_batch(GameBatch* batch, const GameInputs* inputs, Uint32 dt);
+
+Uint64 get_game_batch_steps(const GameBatch* batch);
+
+Uint64 get_game_batch_placements(const GameBatch* batch);
+
+void destroy_game_batch(GameBatch* batch);
+
+// Steps game_count games on the given board, seed and randomizer for a few seconds with fixed inputs and prints steps and
+// placements per second
+void run_game_batch_benchmark(int game_count, int board_width, int board_height, Uint64 seed, PieceRandomizer randomizer, int thread_count);
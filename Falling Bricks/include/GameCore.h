@@ -0,0 +1,126 @@
+#pragma once
+
+#include <SDL.h>
+#include <stdbool.h>
+#include "Grid.h"
+#include "Piece.h"
+#include "PiecePool.h"
+#include "PieceQueue.h"
+
+// The rules of the game with no rendering, audio or timers, so it can be stepped headless as fast as the CPU allows.
+// Time only moves through game_step, the caller decides how much has passed.
+
+typedef enum {
+	GAME_STATE_MENU,
+	GAME_OVER_MENU,
+	GAME_STATE_PLAYING,
+	GAME_STATE_COUNTDOWN,
+	GAME_STATE_PAUSED
+} GameState;
+
+typedef enum {
+	FOURTY_LINES,
+	BLITZ,
+	ENDLESS
+} GameMode;
+
+// Player actions for one step. They are only taken while playing, and stay pending until the piece can act on them.
+typedef struct {
+	bool move_down;
+	bool move_left;
+	bool move_right;
+	bool rotate;
+	bool clockwise;
+	bool hard_drop;
+	bool shift_left; // Move as far left as the piece can go, for auto repeat with no delay between moves
+	bool shift_right;
+} GameInputs;
+
+// Returned by game_step so the front end can play sounds and music
+#define GAME_EVENT_MOVE 0x01 // The piece moved sideways or rotated
+#define GAME_EVENT_LOCK 0x02
+#define GAME_EVENT_CLEAR 0x04
+#define GAME_EVENT_START 0x08 // Countdown finished and the first piece spawned
+#define GAME_EVENT_GAME_OVER 0x10
+
+typedef struct {
+	bool move_player_down;
+	bool move_player_left;
+	bool move_player_right;
+	bool shift_player_left;
+	bool shift_player_right;
+	bool rotate_player;
+	bool clockwise_rotation;
+	bool drop_player;
+	bool check_full_rows;
+	bool dropping_pieces;
+	bool combo;
+} GameFlags;
+
+typedef struct {
+	GameState current_state;
+	GameMode current_mode;
+	int score;
+	int total_lines_cleared;
+	int level;
+	int lines_cleared_this_level;
+	Uint32 time; // Game clock in ms. Stands still while paused.
+	Uint32 last_player_drop_time;
+	Uint32 start_time;
+	Uint32 row_clear_start_time;
+	Uint32 total_row_clear_time;
+	Uint32 elapsed_time;
+	int current_lines_cleared;
+	char main_label[20];
+	Uint32 label_display_start_time;
+	Uint32 level_up_label_display_start_time;
+	Uint32 combo_label_display_start_time;
+	int countdown;
+	Uint32 drop_delay;
+	int required_lines_level_up;
+	GameFlags flags;
+	Grid* board;
+	Piece* player_piece; // NULL between a lock and the next spawn
+	PiecePool* piece_pool;
+	PieceQueue* piece_queue;
+} GameCore;
+
+// Games made with the same seed get the same pieces
+GameCore* create_game_core(int board_width, int board_height, Uint64 seed);
+
+/// <summary>
+/// Sets up a game in memory the caller owns, such as an array of games. Pair with free_game_core.
+/// </summary>
+bool init_game_core(GameCore* game, int board_width, int board_height, Uint64 seed);
+
+void free_game_core(GameCore* game);
+
+/// <summary>
+/// Restarts the piece sequence. Games started after the same seed and randomizer get the same pieces.
+/// </summary>
+void seed_game_core(GameCore* game, Uint64 seed, PieceRandomizer randomizer);
+
+/// <summary>
+/// Resets the score and board state and starts the countdown for a new game in the given mode.
+/// </summary>
+void start_game_mode(GameCore* game, GameMode mode);
+
+/// <summary>
+/// Clears the board and goes back to the menu state.
+/// </summary>
+void reset_game_core(GameCore* game);
+
+void toggle_game_pause(GameCore* game);
+
+/// <summary>
+/// Advances the game by dt milliseconds, taking inputs if playing. Returns the GAME_EVENT_ flags for what happened.
+/// </summary>
+Uint32 game_step(GameCore* game, const GameInputs* inputs, Uint32 dt);
+
+/// <summary>
+/// Zobrist hash of the position: the locked cells, the piece in play and the preview queue. Equal positions hash the
+/// same however they were reached, so searchers can use it to spot repeats. Score and timers are left out.
+/// </summary>
+Uint64 get_game_hash(const GameCore* game);
+
+void destroy_game_core(GameCore* game);
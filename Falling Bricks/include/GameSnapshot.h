@@ -0,0 +1,53 @@
+#pragma once
+
+#include <SDL.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "GameCore.h"
+
+// The whole state of a game packed into one block: the GameCore fields and flags, the board's cells and occupancy, the
+// locked pieces, the piece in play, the queue and its random generator. Only pieces in use are saved, so a 10x20 game
+// is a couple of KB and taking or restoring one is a few block copies. Restoring puts the game back exactly, so it
+// steps on the same as it did from that point, and a snapshot can also be restored into another game of the same size
+// to fork it.
+
+typedef struct {
+	Uint8* data;
+	size_t size;
+	size_t capacity; // Grows when a snapshot needs more room, then stays
+} GameSnapshot;
+
+// The last capacity frames of a game, for rolling back to any of them
+typedef struct {
+	GameSnapshot* snapshots; // Frame f is kept in slot f % capacity
+	Uint64* frames; // Frame each slot holds
+	bool* saved;
+	int capacity;
+} SnapshotRing;
+
+/// <summary>
+/// Copies the game's state into snapshot, growing it if needed. False only if it couldn't grow.
+/// </summary>
+bool take_game_snapshot(const GameCore* game, GameSnapshot* snapshot);
+
+/// <summary>
+/// Puts the game back to the state in snapshot. The game needs the board size and preview length it was taken with.
+/// </summary>
+bool restore_game_snapshot(GameCore* game, const GameSnapshot* snapshot);
+
+void free_game_snapshot(GameSnapshot* snapshot);
+
+SnapshotRing* create_snapshot_ring(int capacity);
+
+/// <summary>
+/// Saves the game as it is at frame, replacing the frame capacity frames before it.
+/// </summary>
+bool save_snapshot_frame(SnapshotRing* ring, const GameCore* game, Uint64 frame);
+
+/// <summary>
+/// Restores the game to how it was at frame, dropping the frames saved after it since they no longer happened.
+/// False if frame isn't held.
+/// </summary>
+bool rollback_to_frame(SnapshotRing* ring, GameCore* game, Uint64 frame);
+
+void destroy_snapshot_ring(SnapshotRing* ring);
@@ -4,45 +4,92 @@
 #include <stdbool.h>
 #include "Piece.h"
 #include "DynamicArray.h"
+#include "PiecePool.h"
 
+#define MAX_GRID_WIDTH 256 // Up to four Uint64 words of row_bits per row
+#define GRID_ROW_WORDS(width) (((width) + 63) / 64)
+
+#define CELL_NO_PIECE 0
+#define CELL_ACTIVE_PIECE 1 // The unlocked piece the grid was last drawn with
+#define CELL_POOL_OFFSET 2 // Locked pieces are stored as their piece pool slot plus this offset
+
+// Packed into 4 bytes so a whole board is one small contiguous block
 typedef struct {
-	Piece* piece;
-	bool locked;
-	bool shadow;
-	bool x;
+	Uint32 piece_ref : 29;
+	Uint32 locked : 1;
+	Uint32 shadow : 1;
+	Uint32 x : 1;
 } Cell;
 
 typedef struct {
-	Cell** cells;
+	Cell* cells; // Row major, width * height
+	Piece* active_piece; // Unlocked piece referenced by CELL_ACTIVE_PIECE cells
 	int width;
 	int height;
 	bool show_grid_lines;
 	bool is_game_board;
 	bool* full_rows;
-	Uint32 fade_start_time;
 	DynamicArray* locked_pieces;
+	PiecePool* piece_pool; // Owns every piece in locked_pieces
+	Uint64* row_bits; // row_words per row. Bit col % 64 of word col / 64 is set when cells[row][col] is locked
+	int row_words;
+	Uint64 last_word_mask; // Value of the last word of a row when every cell in it is locked
+	int* column_tops; // Row of the highest locked cell in each column, height when the column is empty
+	int stack_top; // Highest row holding any locked cell, height when the grid is empty
+	bool column_tops_dirty; // Set when a cell at the top of a column is unlocked, tops get rebuilt before the next use
+	Uint32 lock_version; // Bumped whenever a cell is locked or unlocked
+	Uint64 board_hash; // XOR of get_cell_key for every locked cell, kept up to date as cells lock and unlock
+	Piece drawn_piece; // Copy of the unlocked piece as last drawn, so only its own cells need undoing
+	int drawn_shadow_row; // Row its shadow was drawn at, -1 if none
+	bool has_drawn_piece;
+	Uint32 drawn_lock_version; // lock_version when the piece and shadow were drawn
+	int* gravity_queue; // Scratch for drop_all_pieces, ring of piece pool slots waiting to settle
+	int* gravity_shift; // Scratch for drop_all_pieces, empty rows below each gathered piece
+	bool* gravity_queued; // Scratch for drop_all_pieces, indexed by piece pool slot
+	Piece** split_pieces; // Scratch for clear_full_rows, pieces a cleared row cuts in two. At most one per column.
+	int x_top; // Rows with x marks, so drawing can skip empty rows. x_top > x_bottom when there are none.
+	int x_bottom;
 } Grid;
 
 Grid* create_grid(int width, int height, bool show_lines, bool is_game_board);
 
 void destroy_grid(Grid* grid);
 
+Cell* get_grid_cell(Grid* grid, int row, int col);
+
+Piece* get_cell_piece(Grid* grid, int row, int col);
+
+int get_stack_top(Grid* grid);
+
+bool is_near_height_limit(Grid* grid);
+
 bool validate_piece_position(Grid* grid, Piece* piece);
 
 bool validate_piece_at_position(Grid* grid, Piece* piece, int row, int col);
 
+/// <summary>
+/// How many columns piece can move left, or right, from where it is before it hits a locked cell or the wall. Each of
+/// its cells finds the nearest locked cell in its row straight from row_bits, so the cost doesn't grow with the distance.
+/// </summary>
+int get_shift_distance(Grid* grid, const Piece* piece, bool left);
+
 bool add_piece_to_grid(Grid* grid, Piece* piece, bool lock, bool drop);
 
+bool is_piece_drawn(Grid* grid, const Piece* piece);
+
 void mark_x_cells(Grid* grid, Piece* piece);
 
-Piece* try_rotate_piece(Grid* grid, Piece* piece, bool clockwise);
+/// <summary>
+/// Finds where piece lands when turned into rotated's orientation, trying each wall kick in order. False if every kick collides.
+/// </summary>
+bool find_rotation_position(Grid* grid, const Piece* piece, Piece* rotated, int* row, int* col);
+
+bool try_rotate_piece(Grid* grid, Piece* piece, bool clockwise);
 
 void clear_unlocked_cells(Grid* grid);
 
 void clear_grid(Grid* grid);
 
-void draw_grid(Grid* grid, int origin_x, int origin_y, int cell_width, int border_width, SDL_Renderer* renderer);
-
 int check_and_mark_full_rows(Grid* grid);
 
 void clear_full_rows(Grid* grid);
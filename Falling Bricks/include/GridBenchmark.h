@@ -0,0 +1,4 @@
+#pragma once
+
+// Times the main Grid operations on boards from the default size up to the largest custom size and prints the cost of each
+void run_grid_benchmark();
\ No newline at end of file
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <SDL.h>
+#include "Grid.h"
+#include "PieceQueue.h"
+
+// Drawing for the board types in the game core, kept apart so the core never needs a renderer
+
+void draw_grid_border(SDL_Renderer* renderer, int origin_x, int origin_y, int inner_width, int inner_height, int border_width);
+
+void draw_cell_block(SDL_Renderer* renderer, const SDL_Rect* cell_rect, SDL_Color color, Uint8 alpha);
+
+/// <summary>
+/// Draws the grid with its border. Cells in rows marked full are drawn with full_row_alpha so they can fade out.
+/// </summary>
+void draw_grid(Grid* grid, int origin_x, int origin_y, int cell_width, int border_width, Uint8 full_row_alpha, SDL_Renderer* renderer);
+
+/// <summary>
+/// Draws the previewed pieces top to bottom inside a border, shrinking cells if needed so the panel fits in max_height.
+/// </summary>
+void draw_piece_queue(const PieceQueue* queue, int x, int y, int cell_width, int max_height, int border_width, SDL_Renderer* renderer);
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <SDL.h>
+#include <stdbool.h>
+#include "GameCore.h"
+
+// Player inputs in the order they happened, each stamped with when it happened so the game can apply it in the step
+// that covers that moment. Every press is its own event, so presses close together are never merged.
+// One thread pushes and one pops, without locks: each side only writes its own index and publishes it with a release
+// store the other side reads with an acquire load.
+// The queue also measures how long inputs wait between happening and being applied.
+
+#define INPUT_QUEUE_CAPACITY 256 // Must be a power of two
+#define INPUT_LATENCY_BUCKET 100 // us covered by each histogram bucket
+#define INPUT_LATENCY_BUCKETS 1000 // Up to 100 ms, the last bucket also holds anything longer
+
+typedef struct {
+	Uint64 time; // When it happened on the clock the game steps by, picks the step it's applied in
+	Uint64 real_time; // When it happened in real us, for measuring latency
+	GameInputs inputs; // The key's inputs, one key per event
+	bool released; // The key was let go rather than pressed. It stops repeating and isn't applied as an input.
+} InputEvent;
+
+typedef struct {
+	Uint64 count;
+	Uint64 total; // us
+	Uint64 max;
+	Uint32 histogram[INPUT_LATENCY_BUCKETS];
+} InputLatency;
+
+typedef struct {
+	InputEvent events[INPUT_QUEUE_CAPACITY];
+	Uint32 head; // Next event to pop, written only by the consumer
+	Uint32 tail; // Next free slot, written only by the producer
+	Uint64 dropped; // Pushes that found the queue full
+	InputLatency latency; // Kept by the consumer
+} InputQueue;
+
+InputQueue* create_input_queue();
+
+/// <summary>
+/// Adds an event after the ones already queued. False if the queue is full.
+/// </summary>
+bool push_input_event(InputQueue* queue, const InputEvent* event);
+
+/// <summary>
+/// Takes the oldest event if it happened before time. Events come out in the order they were pushed.
+/// </summary>
+bool pop_input_event_before(InputQueue* queue, Uint64 time, InputEvent* event);
+
+// Empties the queue, for when the game its events were meant for is gone. Consumer side only.
+void clear_input_queue(InputQueue* queue);
+
+/// <summary>
+/// Counts an event as applied at real time applied_time, for the latency statistics.
+/// </summary>
+void record_input_latency(InputQueue* queue, const InputEvent* event, Uint64 applied_time);
+
+/// <summary>
+/// Latency in us that the given fraction of inputs, 0 to 1, were applied within, to the resolution of a bucket.
+/// </summary>
+Uint64 get_input_latency_percentile(const InputLatency* latency, double fraction);
+
+// Prints the count, mean, median, 99th percentile and worst latency, if any inputs were applied
+void print_input_latency(const InputQueue* queue);
+
+void destroy_input_queue(InputQueue* queue);
@@ -28,5 +28,3 @@ SDL_Rect draw_label(SDL_Renderer* renderer, int x, int y, const char* label, Lab
 LabelStyle default_label_style_no_font();
 
 void time_formater(char* mins_secs_buffer, char* millis_buffer, size_t size_of_buffers, Uint32 time_in_ms);
-
-const char* get_row_clear_label(int rows);
@@ -4,6 +4,8 @@
 #include "Button.h"
 #include "ResolutionContext.h"
 #include "DynamicArray.h"
+#include "Random.h"
+#include "Clock.h"
 
 #define BLOCK_INTERVAL 1500
 
@@ -13,7 +15,9 @@ struct TitleMenu {
 	ResolutionContext res_context;
 	DynamicArray* floating_grids;
 	DynamicArray* grid_positions;
-	Uint32 floating_grid_creation_time;
+	const Clock* clock;
+	Uint64 floating_grid_creation_time; // ms on clock
+	Random random; // Picks the floating pieces and where they fall
 };
 
 struct GameOverMenu {
@@ -21,7 +25,8 @@ struct GameOverMenu {
 	ResolutionContext res_context;
 };
 
-struct TitleMenu* create_title_menu(ButtonCallback on_click[4]);
+// The floating pieces are timed on clock, which has to outlive the menu
+struct TitleMenu* create_title_menu(ButtonCallback on_click[4], Uint64 seed, const Clock* clock);
 
 void draw_title_menu(struct TitleMenu* menu, SDL_Renderer* renderer);
 
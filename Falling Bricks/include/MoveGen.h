@@ -0,0 +1,68 @@
+#pragma once
+
+#include <SDL.h>
+#include <stdbool.h>
+#include "Grid.h"
+#include "Piece.h"
+
+// Finds every spot a piece can come to rest in from where it spawns, the way a player could get it there:
+// left and right moves, rotations with the same wall kicks as the game, and soft drops. The search is a breadth first
+// walk over (rotation, row, col) states, so every placement comes with one of the shortest input paths to it.
+// All buffers are sized for the board when the generator is created and nothing is allocated while searching.
+
+typedef enum {
+	INPUT_LEFT,
+	INPUT_RIGHT,
+	INPUT_DOWN,
+	INPUT_ROTATE_CW,
+	INPUT_ROTATE_CCW,
+	INPUT_HARD_DROP
+} MoveInput;
+
+#define MOVE_INPUT_COUNT 6
+
+typedef struct {
+	int row; // Top left of the piece's bounding box, like row_pos and col_pos
+	int col;
+	int rotation; // Lowest rotation index with this shape, S pieces always report 0 and LINE, Z and ZR pieces 0 or 1
+	int state; // Search state the piece rests in, used to rebuild the input path
+} Placement;
+
+typedef struct {
+	int width;
+	int height;
+	int state_count; // 4 * width * height, one per rotation and top left cell
+	Uint64* visited; // Bit per state, all clear between searches
+	int* queue; // States in the order they were reached
+	int* parents; // State each state was first reached from, -1 for the spawn state
+	Uint8* parent_inputs; // MoveInput that led from the parent
+	Placement* placements;
+	int placement_count;
+	Piece orientations[4]; // The piece being searched in each rotation
+	int canonical_rotation[4]; // Rotations with identical shapes share their states
+	Uint64 nodes; // States expanded over the generator's lifetime
+} MoveGenerator;
+
+MoveGenerator* create_move_generator(int width, int height);
+
+/// <summary>
+/// Finds every placement of a piece of the given type spawned the way the game spawns it. Returns the number of placements,
+/// which stay in generator->placements until the next search. None if the spawn spot is already blocked.
+/// </summary>
+int generate_placements(MoveGenerator* generator, Grid* grid, enum PieceType type);
+
+/// <summary>
+/// Like generate_placements, but searches from piece's current rotation and position.
+/// </summary>
+int generate_placements_from(MoveGenerator* generator, Grid* grid, const Piece* piece);
+
+/// <summary>
+/// Writes the inputs that take the piece from where the last search started to placement, ending with a hard drop.
+/// Returns the full path length, which may be more than max_length, in which case only the first max_length inputs are written.
+/// </summary>
+int get_placement_path(const MoveGenerator* generator, const Placement* placement, MoveInput* path, int max_length);
+
+void destroy_move_generator(MoveGenerator* generator);
+
+// Counts placement sequences up to max_depth pieces deep on the default board and prints node counts and placements per second
+void run_move_generator_perft(int max_depth);
@@ -2,6 +2,9 @@
 
 #include <stdbool.h>
 #include <SDL.h>
+#include "Random.h"
+
+#define MAX_PIECE_SIZE 4 // Largest width or height any piece (or piece fragment) can have
 
 enum PieceType {
 	LINE = 0,
@@ -13,27 +16,41 @@ enum PieceType {
 	T = 6
 };
 
+#define PIECE_TYPE_COUNT 7
+
 typedef struct {
-    bool* shape;
+    bool shape[MAX_PIECE_SIZE * MAX_PIECE_SIZE]; // Row major, only the first width * height entries are used
     int width;
 	int height;
 	int row_pos;
 	int col_pos;
 	enum PieceType type;
+	int rotation; // Index into the orientation table, 0 is the spawn orientation
     SDL_Color color;
+	Uint8 row_masks[MAX_PIECE_SIZE]; // Bit j of row_masks[i] mirrors shape[i * width + j]. Used for bitboard collision tests.
 } Piece;
 
 
+bool init_piece(Piece* piece, enum PieceType type);
+
 Piece* create_piece(enum PieceType type);
 
-Piece* create_random_piece();
+enum PieceType random_piece_type(Random* random);
+
+Piece* create_random_piece(Random* random);
 
-Piece* rotate_piece(const Piece* piece, bool clockwise);
+void set_piece_rotation(Piece* piece, int rotation);
+
+void rotate_piece(Piece* piece, bool clockwise);
 
 bool is_piece_empty(const Piece* piece);
 
+void update_piece_row_masks(Piece* piece);
+
 Piece* copy_piece(const Piece* piece);
 
-Piece* copy_piece_region(Piece* original, int start_row, int start_col, int new_height, int new_width);
+void init_piece_region(Piece* new_piece, const Piece* original, int start_row, int start_col, int new_height, int new_width);
+
+Piece* copy_piece_region(const Piece* original, int start_row, int start_col, int new_height, int new_width);
 
 void destroy_piece(Piece* piece);
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdbool.h>
+#include "Piece.h"
+
+// Fixed capacity storage for pieces. All memory is allocated up front so acquiring and releasing never touches the heap.
+typedef struct {
+	Piece* pieces;
+	int* free_indices; // Stack of unused slots in pieces
+	int free_count;
+	int capacity;
+	int high_water_mark; // Most pieces ever in use at once
+	int failed_acquires; // Acquires attempted while the pool was full
+} PiecePool;
+
+PiecePool* create_piece_pool(int capacity);
+
+Piece* acquire_piece(PiecePool* pool);
+
+Piece* acquire_new_piece(PiecePool* pool, enum PieceType type);
+
+Piece* acquire_piece_copy(PiecePool* pool, const Piece* piece);
+
+void release_piece(PiecePool* pool, Piece* piece);
+
+int pieces_in_use(const PiecePool* pool);
+
+void reset_piece_pool(PiecePool* pool);
+
+void print_piece_pool_stats(const PiecePool* pool, const char* label);
+
+void destroy_piece_pool(PiecePool* pool);
\ No newline at end of file
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <SDL.h>
+#include "Piece.h"
+
+typedef enum {
+	RANDOMIZER_UNIFORM, // Every piece is picked independently
+	RANDOMIZER_BAG // Pieces are dealt from shuffled bags holding one of each type
+} PieceRandomizer;
+
+// Upcoming piece types in a fixed ring buffer. The buffer is always full, so taking a piece refills its slot in O(1).
+typedef struct {
+	enum PieceType* types;
+	int front; // Slot of the next piece to spawn
+	int length; // Number of pieces previewed
+	Random random;
+	PieceRandomizer randomizer;
+	enum PieceType bag[PIECE_TYPE_COUNT];
+	int bag_count; // Pieces left in the bag, dealt from the end
+} PieceQueue;
+
+PieceQueue* create_piece_queue(int length, Uint64 seed);
+
+/// <summary>
+/// Restarts the piece sequence from seed with the given randomizer and refills the queue. The same seed always gives the same pieces.
+/// </summary>
+void seed_piece_queue(PieceQueue* queue, Uint64 seed, PieceRandomizer randomizer);
+
+// Refills the queue with new pieces, continuing the sequence. Any partly dealt bag is thrown away.
+void fill_piece_queue(PieceQueue* queue);
+
+enum PieceType next_piece_type(PieceQueue* queue);
+
+enum PieceType peek_piece_type(const PieceQueue* queue, int index);
+
+void destroy_piece_queue(PieceQueue* queue);
\ No newline at end of file
@@ -0,0 +1,17 @@
+#pragma once
+#include <SDL.h>
+
+// Seedable xoshiro256** generator. Each user keeps its own state, so results are reproducible and threads never share one.
+typedef struct {
+	Uint64 state[4];
+} Random;
+
+void seed_random(Random* random, Uint64 seed);
+
+Uint64 next_random(Random* random);
+
+// Uniform in [0, bound). bound must be greater than 0.
+int random_int(Random* random, int bound);
+
+// Uniform in [0, 1)
+float random_float(Random* random);
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <SDL.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "GameCore.h"
+
+// Games recorded as the seed and mode they started from and the inputs and dt of every game_step after that. Stepping
+// a new game through the same steps plays the game out exactly again.
+//
+// The format is the magic bytes "FBRP", a version byte, then varints (7 bits per byte, low bits first, the top bit set
+// on every byte but the last) for the header and records. Each record is one varint code:
+//   code & 1 == 1   one step with inputs, the input bits being code >> 1 (REPLAY_INPUT_ flags)
+//   code & 3 == 0   code >> 2 steps with no inputs, 0 ending the recording
+//   code & 7 == 2   dt changes by code >> 3, zigzag encoded, for the steps that follow
+//   code & 7 == 6   the game was paused or unpaused
+// After the end come the score, lines and elapsed time the game finished with. Steps at an unchanging dt with no
+// inputs cost nothing but the run they're counted in, so a game is a few KB, mostly a byte per input.
+
+#define REPLAY_VERSION 2 // Version 1 replays play too, they just never have the shift inputs
+#define REPLAY_CHUNK_SIZE 4096 // Bytes a recorder gathers before they're worth handing to the writer
+
+#define REPLAY_INPUT_DOWN 0x01
+#define REPLAY_INPUT_LEFT 0x02
+#define REPLAY_INPUT_RIGHT 0x04
+#define REPLAY_INPUT_ROTATE 0x08
+#define REPLAY_INPUT_CLOCKWISE 0x10
+#define REPLAY_INPUT_HARD_DROP 0x20
+#define REPLAY_INPUT_SHIFT_LEFT 0x40
+#define REPLAY_INPUT_SHIFT_RIGHT 0x80
+
+typedef struct {
+	Uint64 seed; // Given to seed_game_core before start_game_mode
+	PieceRandomizer randomizer;
+	GameMode mode;
+	int board_width;
+	int board_height;
+} ReplayHeader;
+
+// How the game stood when the recording ended
+typedef struct {
+	int score;
+	int total_lines_cleared;
+	Uint32 elapsed_time;
+} ReplayResult;
+
+typedef struct {
+	Uint8* data;
+	size_t size;
+	size_t capacity;
+	size_t flushed; // Bytes already taken by take_replay_chunk
+	Uint32 dt; // dt of the last step written
+	Uint32 idle_steps; // Steps with no inputs waiting to be written as one run
+	bool recording; // Between begin_replay and end_replay
+	bool failed; // Ran out of memory, nothing more is recorded
+} ReplayRecorder;
+
+typedef enum {
+	REPLAY_STEP, // Call game_step with the inputs and dt read
+	REPLAY_PAUSE, // Call toggle_game_pause
+	REPLAY_END, // The recording is over, result holds how it ended
+	REPLAY_ERROR // The data is cut short or not a replay
+} ReplayRecord;
+
+typedef struct {
+	const Uint8* data;
+	size_t size;
+	size_t position;
+	ReplayHeader header;
+	ReplayResult result; // Filled once REPLAY_END is read
+	Uint32 dt;
+	Uint32 idle_steps; // Steps left in the run being played
+	Uint64 steps; // Steps read so far
+} ReplayPlayer;
+
+struct ReplayWriterJob;
+
+// Writes replay bytes to files on a thread of its own, so recording never waits on the disk
+typedef struct {
+	SDL_Thread* thread; // NULL if the thread couldn't start, then writes happen on the calling thread
+	SDL_mutex* lock;
+	SDL_cond* wake;
+	struct ReplayWriterJob* first_job;
+	struct ReplayWriterJob* last_job;
+	bool quit;
+} ReplayWriter;
+
+ReplayRecorder* create_replay_recorder();
+
+/// <summary>
+/// Starts a new recording, dropping whatever was recorded before. Call it just before start_game_mode, with the game
+/// seeded from header->seed.
+/// </summary>
+void begin_replay(ReplayRecorder* recorder, const ReplayHeader* header);
+
+/// <summary>
+/// Records one game_step call. inputs can be NULL for none.
+/// </summary>
+void record_replay_step(ReplayRecorder* recorder, const GameInputs* inputs, Uint32 dt);
+
+// Records a toggle_game_pause call
+void record_replay_pause(ReplayRecorder* recorder);
+
+/// <summary>
+/// Finishes the recording with the game's results. Nothing more is recorded until the next begin_replay.
+/// </summary>
+void end_replay(ReplayRecorder* recorder, const GameCore* game);
+
+/// <summary>
+/// Points data at the bytes recorded since the last call and returns how many there are.
+/// </summary>
+size_t take_replay_chunk(ReplayRecorder* recorder, const Uint8** data);
+
+void destroy_replay_recorder(ReplayRecorder* recorder);
+
+/// <summary>
+/// Reads the header of a recording held in data, which has to stay alive while the player reads it.
+/// False if it isn't a replay this version can play.
+/// </summary>
+bool open_replay(ReplayPlayer* player, const Uint8* data, size_t size);
+
+/// <summary>
+/// Reads what the recorded game did next. inputs and dt are set for REPLAY_STEP.
+/// </summary>
+ReplayRecord read_replay_record(ReplayPlayer* player, GameInputs* inputs, Uint32* dt);
+
+/// <summary>
+/// Reads a whole file into memory, for open_replay. Free the result with free.
+/// </summary>
+Uint8* load_replay_file(const char* path, size_t* size);
+
+ReplayWriter* create_replay_writer();
+
+/// <summary>
+/// Appends size bytes of data to the file at path. The bytes are copied, so data can be reused right away.
+/// Jobs are done in the order they're queued.
+/// </summary>
+bool queue_replay_write(ReplayWriter* writer, const char* path, const Uint8* data, size_t size, bool truncate);
+
+// Finishes every queued write before returning
+void destroy_replay_writer(ReplayWriter* writer);
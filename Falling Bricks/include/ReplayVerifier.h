@@ -0,0 +1,46 @@
+#pragma once
+
+#include <SDL.h>
+#include <stdbool.h>
+#include "Replay.h"
+
+// Re-plays recorded games headless to check the results they claim. Each replay is stepped through a fresh game, so
+// the outcome depends on nothing but the file. Large sets are spread over worker threads that each start with an equal
+// share and steal from the back of another's share once theirs runs out, so a few long games don't hold up the rest.
+
+#define VERIFY_MAX_STEPS (1 << 26) // About 3 days of play at GAME_TICK_RATE. Replays claiming more are rejected rather than run.
+
+typedef enum {
+	VERIFY_MATCH, // Playing the inputs gives the recorded score, lines and time
+	VERIFY_MISMATCH,
+	VERIFY_INVALID // Unreadable, damaged, too long or for a board size the game doesn't allow
+} ReplayVerdict;
+
+typedef struct {
+	const char* path;
+	ReplayVerdict verdict;
+	ReplayResult claimed; // What the replay says the game ended with
+	ReplayResult simulated; // What playing it gave
+	Uint64 steps;
+} ReplayCheck;
+
+/// <summary>
+/// Plays a replay held in memory through a new game and fills in check, all but its path.
+/// </summary>
+void verify_replay(const Uint8* data, size_t size, ReplayCheck* check);
+
+/// <summary>
+/// Checks count replay files on thread_count threads, 0 for one per CPU. checks[i] is filled in for paths[i].
+/// </summary>
+void verify_replay_files(const char* const* paths, int count, int thread_count, ReplayCheck* checks);
+
+/// <summary>
+/// Writes the checks as JSON to path, or to stdout when path is "-". False if the file can't be written.
+/// Nothing timed goes in it, so the same files give the same report on any number of threads.
+/// </summary>
+bool write_replay_report(const char* path, const ReplayCheck* checks, int count);
+
+/// <summary>
+/// Checks the files, writes the report and prints a summary. Returns true if every replay matched.
+/// </summary>
+bool run_replay_verifier(const char* const* paths, int count, int thread_count, const char* report_path);
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <SDL.h>
+#include <stdbool.h>
+
+// Fixed size hash table of 64-bit values keyed by position hash, shared between threads without locks.
+// Each entry keeps its key XORed with its data, so an entry half written by another thread fails the check on read
+// instead of handing back the wrong data. Newer stores always replace older ones in the same slot.
+// An empty slot reads as key 0 holding 0, so callers should store nonzero data, such as a search number starting at 1.
+
+typedef struct {
+	Uint64 check; // key ^ data
+	Uint64 data;
+} TranspositionEntry;
+
+typedef struct {
+	TranspositionEntry* entries;
+	Uint64 mask; // Entry count minus one, the count being a power of two
+	Uint64 hits; // Probes that found their key
+	Uint64 misses;
+	Uint64 stores;
+} TranspositionTable;
+
+/// <summary>
+/// Creates a table of 2^size_bits entries, 16 bytes each.
+/// </summary>
+TranspositionTable* create_transposition_table(int size_bits);
+
+/// <summary>
+/// Looks key up and copies its data out if it is there. Safe to call from any thread, also while others store.
+/// </summary>
+bool probe_transposition_table(TranspositionTable* table, Uint64 key, Uint64* data);
+
+void store_transposition_table(TranspositionTable* table, Uint64 key, Uint64 data);
+
+// Empties the table and resets the counters. Not safe while other threads use it.
+void clear_transposition_table(TranspositionTable* table);
+
+void destroy_transposition_table(TranspositionTable* table);
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <SDL.h>
+
+// Keys for Zobrist hashing. A position's hash is the XOR of the keys of everything in it, so adding or removing one thing
+// is a single XOR. Keys are made by mixing what they stand for instead of being looked up, so boards of any size need no
+// key tables and every build and run agrees on them.
+
+#define ZOBRIST_CELL 1
+#define ZOBRIST_PIECE 2
+#define ZOBRIST_QUEUE 3
+#define ZOBRIST_USER 4 // First domain free for callers' own keys, like search depth
+
+// splitmix64's finalizer with the domain in the top byte
+static inline Uint64 get_zobrist_key(int domain, Uint64 value) {
+	Uint64 key = value ^ ((Uint64)domain << 56);
+	key += 0x9E3779B97F4A7C15ULL;
+	key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	key = (key ^ (key >> 27)) * 0x94D049BB133111EBULL;
+	return key ^ (key >> 31);
+}
+
+// A locked cell. Columns fit in 8 bits since boards are at most 256 wide.
+static inline Uint64 get_cell_key(int row, int col) {
+	return get_zobrist_key(ZOBRIST_CELL, ((Uint64)row << 8) | (Uint64)col);
+}
+
+// The piece in play
+static inline Uint64 get_piece_key(int type, int rotation, int row, int col) {
+	return get_zobrist_key(ZOBRIST_PIECE, ((Uint64)type << 40) | ((Uint64)rotation << 36) | ((Uint64)row << 8) | (Uint64)col);
+}
+
+// An upcoming piece, index 0 being the next to spawn
+static inline Uint64 get_queue_key(int index, int type) {
+	return get_zobrist_key(ZOBRIST_QUEUE, ((Uint64)index << 8) | (Uint64)type);
+}
@@ -0,0 +1,705 @@
+#include "AiPlayer.h"
+#include "BitUtils.h"
+#include "Constants.h"
+#include "Zobrist.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// How much each board feature is worth. Cleared lines are scored the way calculate_score does, squared per clear and
+// tripled for the combo clears gravity sets off, so the search goes for the same things the score rewards.
+#define AI_HEIGHT_WEIGHT -0.51f // Sum of column heights
+#define AI_HOLES_WEIGHT -0.36f // Empty cells with something above them
+#define AI_BUMPINESS_WEIGHT -0.18f // Height differences between neighbouring columns
+#define AI_CLEAR_WEIGHT 0.35f // Per line cleared, squared per clear
+
+static int ai_worker_thread(void* data);
+
+AiSettings get_default_ai_settings() {
+	return (AiSettings) {
+		.beam_width = AI_DEFAULT_BEAM_WIDTH,
+		.search_depth = PREVIEW_LENGTH + 1,
+		.time_budget = AI_DEFAULT_TIME_BUDGET,
+		.input_delay = 0,
+		.thread_count = 0,
+		.clock = NULL
+	};
+}
+
+static bool init_ai_board(AiPlayer* ai, AiBoard* board) {
+	board->bits = malloc(sizeof(Uint64) * ai->row_words * ai->height);
+	board->ids = malloc(sizeof(Uint32) * ai->width * ai->height);
+	board->next_id = 1;
+	board->hash = 0;
+	return board->bits && board->ids;
+}
+
+static void free_ai_board(AiBoard* board) {
+	free(board->bits);
+	free(board->ids);
+}
+
+static void copy_ai_board(const AiPlayer* ai, AiBoard* dest, const AiBoard* source) {
+	memcpy(dest->bits, source->bits, sizeof(Uint64) * ai->row_words * ai->height);
+	memcpy(dest->ids, source->ids, sizeof(Uint32) * ai->width * ai->height);
+	dest->next_id = source->next_id;
+	dest->hash = source->hash;
+}
+
+// Locked pieces keep their piece pool slot as their id, so pieces stay whole when gravity moves them
+static void load_ai_board(const AiPlayer* ai, AiBoard* board, Grid* grid) {
+	memcpy(board->bits, grid->row_bits, sizeof(Uint64) * ai->row_words * ai->height);
+	memset(board->ids, 0, sizeof(Uint32) * ai->width * ai->height);
+	for (int row = 0; row < ai->height; row++) {
+		const Uint64* row_bits = board->bits + (size_t)row * ai->row_words;
+		for (int w = 0; w < ai->row_words; w++) {
+			Uint64 bits = row_bits[w];
+			while (bits) {
+				int col = w * 64 + count_trailing_zeros(bits);
+				bits &= bits - 1;
+				board->ids[row * ai->width + col] = get_grid_cell(grid, row, col)->piece_ref;
+			}
+		}
+	}
+	board->next_id = grid->piece_pool->capacity + CELL_POOL_OFFSET;
+	board->hash = grid->board_hash;
+}
+
+static bool is_cell_set(const AiPlayer* ai, const AiBoard* board, int row, int col) {
+	return (board->bits[(size_t)row * ai->row_words + col / 64] >> (col % 64)) & 1;
+}
+
+static void set_cell(const AiPlayer* ai, AiBoard* board, int row, int col, Uint32 id) {
+	Uint64 bit = (Uint64)1 << (col % 64);
+	Uint64* word = &board->bits[(size_t)row * ai->row_words + col / 64];
+	if (((*word & bit) != 0) != (id != 0)) {
+		board->hash ^= get_cell_key(row, col);
+	}
+	*word = id ? *word | bit : *word & ~bit;
+	board->ids[row * ai->width + col] = id;
+}
+
+static void lock_ai_piece(const AiPlayer* ai, AiBoard* board, const Piece* piece, int row, int col) {
+	Uint32 id = board->next_id++;
+	for (int i = 0; i < piece->height; i++) {
+		for (int j = 0; j < piece->width; j++) {
+			if ((piece->row_masks[i] >> j) & 1) {
+				set_cell(ai, board, row + i, col + j, id);
+			}
+		}
+	}
+}
+
+static bool is_ai_row_full(const AiPlayer* ai, const Uint64* bits) {
+	for (int w = 0; w < ai->row_words - 1; w++) {
+		if (bits[w] != ~(Uint64)0) {
+			return false;
+		}
+	}
+	Uint64 last_mask = ai->width % 64 ? ((Uint64)1 << (ai->width % 64)) - 1 : ~(Uint64)0;
+	return bits[ai->row_words - 1] == last_mask;
+}
+
+static bool is_ai_row_empty(const AiPlayer* ai, const Uint64* bits) {
+	for (int w = 0; w < ai->row_words; w++) {
+		if (bits[w]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Gives every connected group of cells from the same piece its own id, numbered from 1. A cleared row leaves a
+// gap between the parts of a piece it ran through, so those parts become separate units like split_grid_piece makes them.
+static int label_units(AiWorker* worker, AiBoard* board) {
+	const AiPlayer* ai = worker->ai;
+	int width = ai->width;
+	int cell_count = width * ai->height;
+	int* labels = worker->labels;
+	int* stack = worker->stack;
+	memset(labels, 0, sizeof(int) * cell_count);
+	int unit_count = 0;
+	for (int cell = 0; cell < cell_count; cell++) {
+		if (!board->ids[cell] || labels[cell]) {
+			continue;
+		}
+		Uint32 id = board->ids[cell];
+		labels[cell] = ++unit_count;
+		int stack_size = 0;
+		stack[stack_size++] = cell;
+		while (stack_size > 0) {
+			int current = stack[--stack_size];
+			int row = current / width;
+			int col = current % width;
+			int neighbours[4] = {
+				row > 0 ? current - width : -1,
+				row < ai->height - 1 ? current + width : -1,
+				col > 0 ? current - 1 : -1,
+				col < width - 1 ? current + 1 : -1
+			};
+			for (int i = 0; i < 4; i++) {
+				int next = neighbours[i];
+				if (next >= 0 && !labels[next] && board->ids[next] == id) {
+					labels[next] = unit_count;
+					stack[stack_size++] = next;
+				}
+			}
+		}
+	}
+	for (int cell = 0; cell < cell_count; cell++) {
+		board->ids[cell] = labels[cell];
+	}
+	board->next_id = unit_count + 1;
+	return unit_count;
+}
+
+// Removes empty rows so everything above them comes down together, the first half of drop_all_pieces
+static void collapse_empty_rows(const AiPlayer* ai, AiBoard* board) {
+	int row_words = ai->row_words;
+	int width = ai->width;
+	int write_row = ai->height - 1;
+	for (int row = ai->height - 1; row >= 0; row--) {
+		Uint64* bits = board->bits + (size_t)row * row_words;
+		if (is_ai_row_empty(ai, bits)) {
+			continue;
+		}
+		if (write_row != row) {
+			memcpy(board->bits + (size_t)write_row * row_words, bits, sizeof(Uint64) * row_words);
+			memcpy(board->ids + write_row * width, board->ids + row * width, sizeof(Uint32) * width);
+		}
+		write_row--;
+	}
+	if (write_row >= 0) {
+		memset(board->bits, 0, sizeof(Uint64) * row_words * (write_row + 1));
+		memset(board->ids, 0, sizeof(Uint32) * width * (write_row + 1));
+	}
+}
+
+// How far a unit can fall with its own cells lifted off the board
+static int get_fall_distance(const AiPlayer* ai, AiBoard* board, const int* cells, int cell_count) {
+	for (int i = 0; i < cell_count; i++) {
+		set_cell(ai, board, cells[i] / ai->width, cells[i] % ai->width, 0);
+	}
+	int distance = 0;
+	while (true) {
+		bool blocked = false;
+		for (int i = 0; i < cell_count && !blocked; i++) {
+			int row = cells[i] / ai->width + distance + 1;
+			blocked = row >= ai->height || is_cell_set(ai, board, row, cells[i] % ai->width);
+		}
+		if (blocked) {
+			return distance;
+		}
+		distance++;
+	}
+}
+
+// Lets every unit fall on its own, lowest first, until nothing moves. The second half of drop_all_pieces.
+static void drop_units(AiWorker* worker, AiBoard* board, int unit_count) {
+	const AiPlayer* ai = worker->ai;
+	int width = ai->width;
+	int cell_count = width * ai->height;
+	int* unit_start = worker->unit_start;
+	int* unit_cells = worker->unit_cells;
+	int* order = worker->stack;
+
+	int* filled = worker->labels; // Free again once units are labelled
+	memset(unit_start, 0, sizeof(int) * (unit_count + 2));
+	memset(filled, 0, sizeof(int) * (unit_count + 1));
+	for (int cell = 0; cell < cell_count; cell++) {
+		unit_start[board->ids[cell] + 1]++;
+	}
+	unit_start[1] = 0; // Empty cells aren't part of any unit
+	for (int unit = 2; unit <= unit_count + 1; unit++) {
+		unit_start[unit] += unit_start[unit - 1];
+	}
+	// Scanning bottom up orders the units by their lowest row
+	int order_count = 0;
+	for (int cell = cell_count - 1; cell >= 0; cell--) {
+		Uint32 unit = board->ids[cell];
+		if (unit) {
+			if (!filled[unit]) {
+				order[order_count++] = unit;
+			}
+			unit_cells[unit_start[unit] + filled[unit]++] = cell;
+		}
+	}
+
+	bool moved = true;
+	while (moved) {
+		moved = false;
+		for (int i = 0; i < order_count; i++) {
+			int unit = order[i];
+			int* cells = unit_cells + unit_start[unit];
+			int count = unit_start[unit + 1] - unit_start[unit];
+			int distance = get_fall_distance(ai, board, cells, count);
+			for (int j = 0; j < count; j++) {
+				cells[j] += distance * width;
+				set_cell(ai, board, cells[j] / width, cells[j] % width, unit);
+			}
+			moved |= distance > 0;
+		}
+	}
+}
+
+// Cleared rows and collapsing move whole rows at once, so the hash is worked out again afterwards
+static Uint64 hash_ai_board(const AiPlayer* ai, const AiBoard* board) {
+	Uint64 hash = 0;
+	for (int row = 0; row < ai->height; row++) {
+		const Uint64* row_bits = board->bits + (size_t)row * ai->row_words;
+		for (int w = 0; w < ai->row_words; w++) {
+			Uint64 bits = row_bits[w];
+			while (bits) {
+				hash ^= get_cell_key(row, w * 64 + count_trailing_zeros(bits));
+				bits &= bits - 1;
+			}
+		}
+	}
+	return hash;
+}
+
+// Clears full rows and applies gravity until no rows are full. Returns the points the clears are worth.
+static int settle_ai_board(AiWorker* worker, AiBoard* board) {
+	const AiPlayer* ai = worker->ai;
+	int points = 0;
+	for (int clear = 0; ; clear++) {
+		int full_rows = 0;
+		for (int row = 0; row < ai->height; row++) {
+			Uint64* bits = board->bits + (size_t)row * ai->row_words;
+			if (is_ai_row_full(ai, bits)) {
+				memset(bits, 0, sizeof(Uint64) * ai->row_words);
+				memset(board->ids + row * ai->width, 0, sizeof(Uint32) * ai->width);
+				full_rows++;
+			}
+		}
+		if (!full_rows) {
+			if (clear > 0) {
+				board->hash = hash_ai_board(ai, board);
+			}
+			return points;
+		}
+		points += full_rows * full_rows * (clear > 0 ? COMBO_MULTIPLIER : 1);
+		int unit_count = label_units(worker, board);
+		collapse_empty_rows(ai, board);
+		drop_units(worker, board, unit_count);
+	}
+}
+
+// Total order so the beam comes out the same however the nodes were split between threads
+static bool is_better_node(const AiNode* a, const AiNode* b) {
+	if (a->value != b->value) {
+		return a->value > b->value;
+	}
+	if (a->parent != b->parent) {
+		return a->parent < b->parent;
+	}
+	return a->placement.state < b->placement.state;
+}
+
+static int compare_nodes(const void* a, const void* b) {
+	return is_better_node(a, b) ? -1 : is_better_node(b, a) ? 1 : 0;
+}
+
+// Keeps the beam_width best children in a heap with the worst on top, so a better child replaces it in O(log n)
+static void keep_if_better(AiWorker* worker, const AiNode* node) {
+	AiNode* heap = worker->best;
+	int capacity = worker->ai->settings.beam_width;
+	int index;
+	if (worker->best_count < capacity) {
+		index = worker->best_count++;
+		while (index > 0 && is_better_node(&heap[(index - 1) / 2], node)) {
+			heap[index] = heap[(index - 1) / 2];
+			index = (index - 1) / 2;
+		}
+		heap[index] = *node;
+		return;
+	}
+	if (!is_better_node(node, &heap[0])) {
+		return;
+	}
+	index = 0;
+	while (true) {
+		int child = index * 2 + 1;
+		if (child >= capacity) {
+			break;
+		}
+		if (child + 1 < capacity && is_better_node(&heap[child], &heap[child + 1])) {
+			child++;
+		}
+		if (!is_better_node(node, &heap[child])) {
+			break;
+		}
+		heap[index] = heap[child];
+		index = child;
+	}
+	heap[index] = *node;
+}
+
+static float evaluate_features(const BoardFeatures* features) {
+	return AI_HEIGHT_WEIGHT * features->aggregate_height + AI_HOLES_WEIGHT * features->holes + AI_BUMPINESS_WEIGHT * features->bumpiness;
+}
+
+static void evaluate_batch(AiWorker* worker) {
+	const AiPlayer* ai = worker->ai;
+	get_board_features(worker->batch_bits, worker->batch_count, ai->width, ai->height, worker->batch_features);
+	for (int i = 0; i < worker->batch_count; i++) {
+		AiNode* child = &worker->batch_nodes[i];
+		child->value = child->reward + evaluate_features(&worker->batch_features[i]);
+		keep_if_better(worker, child);
+	}
+	worker->batch_count = 0;
+}
+
+static void expand_node(AiWorker* worker, int node_index) {
+	AiPlayer* ai = worker->ai;
+	const AiBoard* board = &ai->expand_boards[node_index];
+	const AiNode* parent = &ai->expand_nodes[node_index];
+	MoveGenerator* generator = worker->generator;
+	Grid* grid = worker->scratch_grid;
+	memcpy(grid->row_bits, board->bits, sizeof(Uint64) * ai->row_words * ai->height);
+
+	int count = ai->expand_piece
+		? generate_placements_from(generator, grid, ai->expand_piece)
+		: generate_placements(generator, grid, ai->expand_type);
+	for (int i = 0; i < count; i++) {
+		const Placement* placement = &generator->placements[i];
+		AiBoard* child_board = &worker->batch[worker->batch_count];
+		copy_ai_board(ai, child_board, board);
+		lock_ai_piece(ai, child_board, &generator->orientations[placement->rotation], placement->row, placement->col);
+		AiNode* child = &worker->batch_nodes[worker->batch_count++];
+		child->parent = node_index;
+		child->placement = *placement;
+		child->first = ai->expand_depth == 0 ? *placement : parent->first;
+		child->reward = parent->reward + AI_CLEAR_WEIGHT * settle_ai_board(worker, child_board);
+		if (worker->batch_count == AI_EVAL_BATCH) {
+			evaluate_batch(worker);
+		}
+	}
+}
+
+static void expand_nodes(AiWorker* worker) {
+	AiPlayer* ai = worker->ai;
+	worker->best_count = 0;
+	worker->batch_count = 0;
+	worker->timed_out = false;
+	for (int i = worker->first_node; i < worker->end_node; i++) {
+		// The first depth always finishes so there is a move to make
+		if (ai->expand_depth > 0 && get_clock_time(ai->clock) >= ai->deadline) {
+			worker->timed_out = true;
+			return;
+		}
+		expand_node(worker, i);
+	}
+	evaluate_batch(worker);
+}
+
+static int ai_worker_thread(void* data) {
+	AiWorker* worker = data;
+	AiPlayer* ai = worker->ai;
+	while (true) {
+		SDL_SemWait(worker->start);
+		if (ai->quit) {
+			break;
+		}
+		expand_nodes(worker);
+		SDL_SemPost(ai->done);
+	}
+	return 0;
+}
+
+static bool init_ai_worker(AiPlayer* ai, AiWorker* worker) {
+	int cell_count = ai->width * ai->height;
+	worker->ai = ai;
+	worker->generator = create_move_generator(ai->width, ai->height);
+	worker->scratch_grid = create_grid(ai->width, ai->height, false, false);
+	worker->labels = malloc(sizeof(int) * (cell_count + 1));
+	worker->unit_cells = malloc(sizeof(int) * cell_count);
+	worker->unit_start = malloc(sizeof(int) * (cell_count + 2));
+	worker->stack = malloc(sizeof(int) * cell_count);
+	worker->best = malloc(sizeof(AiNode) * ai->settings.beam_width);
+	bool boards_created = true;
+	for (int i = 0; i < AI_EVAL_BATCH; i++) {
+		boards_created &= init_ai_board(ai, &worker->batch[i]);
+		worker->batch_bits[i] = worker->batch[i].bits;
+	}
+	return boards_created && worker->generator && worker->scratch_grid && worker->labels
+		&& worker->unit_cells && worker->unit_start && worker->stack && worker->best;
+}
+
+static void free_ai_worker(AiWorker* worker) {
+	destroy_move_generator(worker->generator);
+	destroy_grid(worker->scratch_grid);
+	for (int i = 0; i < AI_EVAL_BATCH; i++) {
+		free_ai_board(&worker->batch[i]);
+	}
+	free(worker->labels);
+	free(worker->unit_cells);
+	free(worker->unit_start);
+	free(worker->stack);
+	free(worker->best);
+}
+
+// Threads that fail to start just leave their share of the nodes to the calling thread
+static bool start_ai_workers(AiPlayer* ai, int thread_count) {
+	ai->workers = calloc(thread_count, sizeof(AiWorker));
+	ai->done = SDL_CreateSemaphore(0);
+	if (!ai->workers || !ai->done) {
+		fprintf(stderr, "Error: Failed to allocate AI workers\n");
+		return false;
+	}
+	for (int i = 0; i < thread_count; i++) {
+		AiWorker* worker = &ai->workers[i];
+		if (!init_ai_worker(ai, worker)) {
+			fprintf(stderr, "Error: Failed to allocate AI worker buffers\n");
+			free_ai_worker(worker);
+			return i > 0;
+		}
+		if (i > 0) {
+			worker->start = SDL_CreateSemaphore(0);
+			worker->thread = worker->start ? SDL_CreateThread(ai_worker_thread, "AiWorker", worker) : NULL;
+			if (!worker->thread) {
+				fprintf(stderr, "Error: Failed to start AI worker thread: %s\n", SDL_GetError());
+				if (worker->start) {
+					SDL_DestroySemaphore(worker->start);
+				}
+				free_ai_worker(worker);
+				*worker = (AiWorker){ 0 };
+				return true;
+			}
+		}
+		ai->worker_count++;
+	}
+	return true;
+}
+
+AiPlayer* create_ai_player(int board_width, int board_height, const AiSettings* settings) {
+	if (board_width <= 0 || board_width > MAX_GRID_WIDTH || board_height <= 0) {
+		fprintf(stderr, "Error: Invalid AI board dimensions %dx%d\n", board_width, board_height);
+		return NULL;
+	}
+	AiPlayer* ai = calloc(1, sizeof(AiPlayer));
+	if (!ai) {
+		fprintf(stderr, "Error: Failed to allocate memory for AiPlayer\n");
+		return NULL;
+	}
+	ai->settings = settings ? *settings : get_default_ai_settings();
+	ai->settings.beam_width = MAX(1, ai->settings.beam_width);
+	ai->settings.search_depth = MAX(1, ai->settings.search_depth);
+	init_real_clock(&ai->real_clock);
+	ai->clock = ai->settings.clock ? ai->settings.clock : &ai->real_clock;
+	ai->width = board_width;
+	ai->height = board_height;
+	ai->row_words = GRID_ROW_WORDS(board_width);
+
+	int beam_width = ai->settings.beam_width;
+	for (int i = 0; i < 2; i++) {
+		ai->boards[i] = calloc(beam_width, sizeof(AiBoard));
+		ai->nodes[i] = malloc(sizeof(AiNode) * beam_width);
+		if (!ai->boards[i] || !ai->nodes[i]) {
+			fprintf(stderr, "Error: Failed to allocate AI beam\n");
+			destroy_ai_player(ai);
+			return NULL;
+		}
+		for (int j = 0; j < beam_width; j++) {
+			if (!init_ai_board(ai, &ai->boards[i][j])) {
+				fprintf(stderr, "Error: Failed to allocate AI beam\n");
+				destroy_ai_player(ai);
+				return NULL;
+			}
+		}
+	}
+
+	int thread_count = ai->settings.thread_count > 0 ? ai->settings.thread_count : SDL_GetCPUCount();
+	thread_count = MAX(1, MIN(thread_count, beam_width));
+	ai->merged = malloc(sizeof(AiNode) * beam_width * thread_count);
+	ai->seen = create_transposition_table(AI_SEEN_TABLE_BITS);
+	if (!ai->merged || !ai->seen || !start_ai_workers(ai, thread_count)) {
+		destroy_ai_player(ai);
+		return NULL;
+	}
+	return ai;
+}
+
+void destroy_ai_player(AiPlayer* ai) {
+	if (!ai) return;
+	ai->quit = true;
+	for (int i = 1; i < ai->worker_count; i++) {
+		SDL_SemPost(ai->workers[i].start);
+		SDL_WaitThread(ai->workers[i].thread, NULL);
+		SDL_DestroySemaphore(ai->workers[i].start);
+	}
+	for (int i = 0; i < ai->worker_count; i++) {
+		free_ai_worker(&ai->workers[i]);
+	}
+	free(ai->workers);
+	if (ai->done) {
+		SDL_DestroySemaphore(ai->done);
+	}
+	for (int i = 0; i < 2; i++) {
+		if (ai->boards[i]) {
+			for (int j = 0; j < ai->settings.beam_width; j++) {
+				free_ai_board(&ai->boards[i][j]);
+			}
+		}
+		free(ai->boards[i]);
+		free(ai->nodes[i]);
+	}
+	free(ai->merged);
+	destroy_transposition_table(ai->seen);
+	free(ai);
+}
+
+// Expands every node of the current depth across the workers. False if the time budget ran out first.
+static bool expand_depth(AiPlayer* ai, int node_count) {
+	for (int i = 0; i < ai->worker_count; i++) {
+		ai->workers[i].first_node = (int)((Sint64)node_count * i / ai->worker_count);
+		ai->workers[i].end_node = (int)((Sint64)node_count * (i + 1) / ai->worker_count);
+	}
+	for (int i = 1; i < ai->worker_count; i++) {
+		SDL_SemPost(ai->workers[i].start);
+	}
+	expand_nodes(&ai->workers[0]);
+	for (int i = 1; i < ai->worker_count; i++) {
+		SDL_SemWait(ai->done);
+	}
+	for (int i = 0; i < ai->worker_count; i++) {
+		if (ai->workers[i].timed_out) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Picks the best children of all workers as the next beam and plays them out onto its boards
+static int select_beam(AiPlayer* ai, int current) {
+	int next = 1 - current;
+	int merged_count = 0;
+	for (int i = 0; i < ai->worker_count; i++) {
+		AiWorker* worker = &ai->workers[i];
+		memcpy(ai->merged + merged_count, worker->best, sizeof(AiNode) * worker->best_count);
+		merged_count += worker->best_count;
+	}
+	qsort(ai->merged, merged_count, sizeof(AiNode), compare_nodes);
+
+	// Only the best beam_width are looked at, which are the same however many threads found them, so dropping
+	// repeats can't make the result depend on the thread count. The best line of play to a board is the one kept.
+	int candidate_count = MIN(merged_count, ai->settings.beam_width);
+	Uint64 depth_key = get_zobrist_key(ZOBRIST_USER, (Uint64)ai->expand_depth);
+	AiWorker* worker = &ai->workers[0];
+	int count = 0;
+	for (int i = 0; i < candidate_count; i++) {
+		const AiNode* node = &ai->merged[i];
+		AiBoard* board = &ai->boards[next][count];
+		Piece piece;
+		init_piece(&piece, ai->expand_type);
+		set_piece_rotation(&piece, node->placement.rotation);
+		copy_ai_board(ai, board, &ai->boards[current][node->parent]);
+		lock_ai_piece(ai, board, &piece, node->placement.row, node->placement.col);
+		settle_ai_board(worker, board);
+		Uint64 search;
+		Uint64 key = board->hash ^ depth_key;
+		if (probe_transposition_table(ai->seen, key, &search) && search == ai->searches) {
+			continue;
+		}
+		store_transposition_table(ai->seen, key, ai->searches);
+		ai->nodes[next][count++] = *node;
+	}
+	ai->node_count[next] = count;
+	return count;
+}
+
+// Beam search over the piece in play and the preview. Returns false if the piece has nowhere to go.
+static bool search_placement(AiPlayer* ai, GameCore* game) {
+	ai->deadline = get_clock_time(ai->clock) + (Uint64)ai->settings.time_budget * 1000;
+	ai->searches++;
+
+	int current = 0;
+	load_ai_board(ai, &ai->boards[0][0], game->board);
+	ai->nodes[0][0] = (AiNode){ .parent = -1 };
+	ai->node_count[0] = 1;
+	int depth_count = MIN(ai->settings.search_depth, game->piece_queue->length + 1);
+	bool found = false;
+	for (int depth = 0; depth < depth_count; depth++) {
+		ai->expand_depth = depth;
+		ai->expand_piece = depth == 0 ? game->player_piece : NULL;
+		ai->expand_type = depth == 0 ? game->player_piece->type : peek_piece_type(game->piece_queue, depth - 1);
+		ai->expand_boards = ai->boards[current];
+		ai->expand_nodes = ai->nodes[current];
+		ai->nodes_searched += ai->node_count[current];
+		if (!expand_depth(ai, ai->node_count[current]) || select_beam(ai, current) == 0) {
+			break;
+		}
+		current = 1 - current;
+		ai->target = ai->nodes[current][0].first;
+		found = true;
+	}
+	ai->expand_piece = NULL;
+	return found;
+}
+
+static bool find_target(AiPlayer* ai, const MoveGenerator* generator, int count, const Placement** placement) {
+	for (int i = 0; i < count; i++) {
+		const Placement* candidate = &generator->placements[i];
+		if (candidate->row == ai->target.row && candidate->col == ai->target.col && candidate->rotation == ai->target.rotation) {
+			*placement = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+void get_ai_inputs(AiPlayer* ai, GameCore* game, GameInputs* inputs) {
+	Piece* piece = game->player_piece;
+	if (game->current_state != GAME_STATE_PLAYING || !piece) {
+		ai->has_target = false; // The next piece gets its own search
+		return;
+	}
+	if (game->board->width != ai->width || game->board->height != ai->height) {
+		fprintf(stderr, "Error: AI player is for %dx%d boards, not %dx%d\n", ai->width, ai->height, game->board->width, game->board->height);
+		return;
+	}
+	if (ai->has_target && game->time - ai->last_input_time < ai->settings.input_delay) {
+		return;
+	}
+
+	// Gravity can pull the piece below a path that needed it higher, so the path is found again from where the piece is
+	MoveGenerator* generator = ai->workers[0].generator;
+	const Placement* placement = NULL;
+	bool reachable = false;
+	if (ai->has_target) {
+		reachable = find_target(ai, generator, generate_placements_from(generator, game->board, piece), &placement);
+	}
+	if (!reachable) {
+		ai->has_target = true;
+		if (search_placement(ai, game)) {
+			reachable = find_target(ai, generator, generate_placements_from(generator, game->board, piece), &placement);
+		}
+	}
+	ai->last_input_time = game->time;
+	if (!reachable) {
+		inputs->hard_drop = true;
+		return;
+	}
+
+	MoveInput input;
+	get_placement_path(generator, placement, &input, 1);
+	switch (input) {
+	case INPUT_LEFT:
+		inputs->move_left = true;
+		break;
+	case INPUT_RIGHT:
+		inputs->move_right = true;
+		break;
+	case INPUT_DOWN:
+		inputs->move_down = true;
+		break;
+	case INPUT_ROTATE_CW:
+	case INPUT_ROTATE_CCW:
+		inputs->rotate = true;
+		inputs->clockwise = input == INPUT_ROTATE_CW;
+		break;
+	case INPUT_HARD_DROP:
+		inputs->hard_drop = true;
+		break;
+	}
+}
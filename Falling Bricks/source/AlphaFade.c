@@ -1,9 +1,10 @@
 #include "AlphaFade.h"
 #include <SDL.h>
 
-Uint8 get_fade_alpha(Uint32 start_time, Uint32 duration) {
-	Uint32 now = SDL_GetTicks();
-	if (now >= start_time + duration) return 0;
+// Times are on whatever clock the caller uses, so labels can follow game time. Only differences are compared, so the
+// clock wrapping around between start_time and now doesn't matter.
+Uint8 get_fade_alpha(Uint32 start_time, Uint32 duration, Uint32 now) {
+	if (now - start_time >= duration) return 0;
 
 	float progress = (float)(now - start_time) / duration;
 	float alpha = 1.0f - progress;
@@ -7,7 +7,7 @@
 
 static AudioContext* audio_context = NULL; // Singleton instance
 
-bool create_audio_context() {
+bool create_audio_context(Uint64 seed) {
 	if (audio_context) {
 		fprintf(stderr, "AudioContext already created.\n");
 		return false;
@@ -55,6 +55,7 @@ bool create_audio_context() {
 
 	audio_context->music_paused = false;
 	audio_context->sound_enabled = true;
+	seed_random(&audio_context->random, seed);
 
 	return true;
 }
@@ -65,7 +66,7 @@ AudioContext* get_audio_context() {
 
 void play_random_music() {
 	if (audio_context) {
-		int random_index = rand() % NUM_SONGS;
+		int random_index = random_int(&audio_context->random, NUM_SONGS);
 		if (Mix_PlayMusic(audio_context->music[random_index], 0) == -1) {
 			fprintf(stderr, "Error playing music: %s\n", Mix_GetError());
 		}
@@ -0,0 +1,84 @@
+#include "AutoRepeat.h"
+#include "Constants.h"
+
+AutoRepeatSettings get_default_auto_repeat_settings() {
+	return (AutoRepeatSettings) {
+		.das = AUTO_REPEAT_DEFAULT_DAS,
+		.arr = AUTO_REPEAT_DEFAULT_ARR,
+		.soft_drop_factor = AUTO_REPEAT_DEFAULT_SOFT_DROP_FACTOR
+	};
+}
+
+void init_auto_repeat(AutoRepeat* repeat, const AutoRepeatSettings* settings) {
+	*repeat = (AutoRepeat){ .settings = settings ? *settings : get_default_auto_repeat_settings() };
+	repeat->settings.soft_drop_factor = MAX(1, repeat->settings.soft_drop_factor);
+}
+
+static void start_shift(AutoRepeat* repeat, int direction, Uint64 time) {
+	repeat->direction = direction;
+	repeat->next_shift = time + (Uint64)repeat->settings.das * 1000;
+}
+
+void press_auto_repeat_keys(AutoRepeat* repeat, const GameInputs* inputs, Uint64 time) {
+	if (inputs->move_left) {
+		repeat->left_held = true;
+		start_shift(repeat, -1, time);
+	}
+	if (inputs->move_right) {
+		repeat->right_held = true;
+		start_shift(repeat, 1, time);
+	}
+	if (inputs->move_down && !repeat->down_held) {
+		repeat->down_held = true;
+		repeat->last_drop = time;
+	}
+}
+
+void release_auto_repeat_keys(AutoRepeat* repeat, const GameInputs* inputs, Uint64 time) {
+	if (inputs->move_left) {
+		repeat->left_held = false;
+	}
+	if (inputs->move_right) {
+		repeat->right_held = false;
+	}
+	if (inputs->move_down) {
+		repeat->down_held = false;
+	}
+	if (repeat->direction < 0 && !repeat->left_held) {
+		repeat->direction = 0;
+		if (repeat->right_held) {
+			start_shift(repeat, 1, time);
+		}
+	}
+	else if (repeat->direction > 0 && !repeat->right_held) {
+		repeat->direction = 0;
+		if (repeat->left_held) {
+			start_shift(repeat, -1, time);
+		}
+	}
+}
+
+void take_auto_repeats(AutoRepeat* repeat, Uint64 time, Uint32 drop_delay, int max_moves, int* shifts, int* drops, bool* to_wall) {
+	*shifts = 0;
+	*drops = 0;
+	*to_wall = false;
+	if (repeat->direction && repeat->next_shift < time) {
+		if (repeat->settings.arr == 0) {
+			// Stays due, so pieces that spawn while the key is held go straight to the wall too
+			*to_wall = true;
+		}
+		else {
+			Uint64 interval = (Uint64)repeat->settings.arr * 1000;
+			Uint64 due = (time - 1 - repeat->next_shift) / interval + 1;
+			*shifts = (int)MIN(due, (Uint64)max_moves);
+			repeat->next_shift += due * interval;
+		}
+	}
+	// Spaced by the gravity of the moment, so it speeds up with the level part way through a hold
+	Uint64 interval = MAX((Uint64)drop_delay * 1000 / repeat->settings.soft_drop_factor, 1);
+	if (repeat->down_held && repeat->last_drop + interval < time) {
+		Uint64 due = (time - 1 - repeat->last_drop) / interval;
+		*drops = (int)MIN(due, (Uint64)max_moves);
+		repeat->last_drop += due * interval;
+	}
+}
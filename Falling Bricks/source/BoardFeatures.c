@@ -0,0 +1,213 @@
+#include "BoardFeatures.h"
+#include "BitUtils.h"
+#include "Constants.h"
+#include "Grid.h"
+#include <stdbool.h>
+#include <string.h>
+
+// Every feature is a popcount of a few whole-row bit operations, so each row is handled in one go instead of cell by cell:
+//  - a column's height is the number of rows at or below its top, so summing popcount(seen) over the rows gives the
+//    aggregate height, where seen is every row so far ORed together
+//  - heights of neighbouring columns differ by the number of rows where exactly one of them has been seen
+//  - a well cell has nothing above it (not seen) and both neighbours filled
+
+#if !defined(BOARD_FEATURES_NO_SIMD) && defined(__AVX2__)
+#include <immintrin.h>
+#define FEATURE_LANES 4
+typedef __m256i FeatureVector;
+
+static inline FeatureVector load_rows(const Uint64* const* boards, int row) {
+	return _mm256_set_epi64x((long long)boards[3][row], (long long)boards[2][row], (long long)boards[1][row], (long long)boards[0][row]);
+}
+static inline FeatureVector splat(Uint64 bits) { return _mm256_set1_epi64x((long long)bits); }
+static inline FeatureVector vec_and(FeatureVector a, FeatureVector b) { return _mm256_and_si256(a, b); }
+static inline FeatureVector vec_or(FeatureVector a, FeatureVector b) { return _mm256_or_si256(a, b); }
+static inline FeatureVector vec_xor(FeatureVector a, FeatureVector b) { return _mm256_xor_si256(a, b); }
+static inline FeatureVector vec_and_not(FeatureVector a, FeatureVector b) { return _mm256_andnot_si256(a, b); } // ~a & b
+static inline FeatureVector vec_add(FeatureVector a, FeatureVector b) { return _mm256_add_epi64(a, b); }
+static inline FeatureVector shift_left_1(FeatureVector a) { return _mm256_slli_epi64(a, 1); }
+static inline FeatureVector shift_right_1(FeatureVector a) { return _mm256_srli_epi64(a, 1); }
+static inline FeatureVector shift_right_6(FeatureVector a) { return _mm256_srli_epi64(a, 6); }
+
+// Bit counts of each byte, then summed into each 64-bit lane
+static inline FeatureVector count_bits(FeatureVector x) {
+	x = _mm256_sub_epi8(x, _mm256_and_si256(_mm256_srli_epi64(x, 1), _mm256_set1_epi8(0x55)));
+	x = _mm256_add_epi8(_mm256_and_si256(x, _mm256_set1_epi8(0x33)), _mm256_and_si256(_mm256_srli_epi64(x, 2), _mm256_set1_epi8(0x33)));
+	x = _mm256_and_si256(_mm256_add_epi8(x, _mm256_srli_epi64(x, 4)), _mm256_set1_epi8(0x0F));
+	return _mm256_sad_epu8(x, _mm256_setzero_si256());
+}
+
+static inline void store_lanes(Uint64* lanes, FeatureVector a) { _mm256_storeu_si256((__m256i*)lanes, a); }
+
+#elif !defined(BOARD_FEATURES_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define FEATURE_LANES 2
+typedef __m128i FeatureVector;
+
+static inline FeatureVector load_rows(const Uint64* const* boards, int row) {
+	return _mm_set_epi64x((long long)boards[1][row], (long long)boards[0][row]);
+}
+static inline FeatureVector splat(Uint64 bits) { return _mm_set1_epi64x((long long)bits); }
+static inline FeatureVector vec_and(FeatureVector a, FeatureVector b) { return _mm_and_si128(a, b); }
+static inline FeatureVector vec_or(FeatureVector a, FeatureVector b) { return _mm_or_si128(a, b); }
+static inline FeatureVector vec_xor(FeatureVector a, FeatureVector b) { return _mm_xor_si128(a, b); }
+static inline FeatureVector vec_and_not(FeatureVector a, FeatureVector b) { return _mm_andnot_si128(a, b); } // ~a & b
+static inline FeatureVector vec_add(FeatureVector a, FeatureVector b) { return _mm_add_epi64(a, b); }
+static inline FeatureVector shift_left_1(FeatureVector a) { return _mm_slli_epi64(a, 1); }
+static inline FeatureVector shift_right_1(FeatureVector a) { return _mm_srli_epi64(a, 1); }
+static inline FeatureVector shift_right_6(FeatureVector a) { return _mm_srli_epi64(a, 6); }
+
+// Bit counts of each byte, then summed into each 64-bit lane
+static inline FeatureVector count_bits(FeatureVector x) {
+	x = _mm_sub_epi8(x, _mm_and_si128(_mm_srli_epi64(x, 1), _mm_set1_epi8(0x55)));
+	x = _mm_add_epi8(_mm_and_si128(x, _mm_set1_epi8(0x33)), _mm_and_si128(_mm_srli_epi64(x, 2), _mm_set1_epi8(0x33)));
+	x = _mm_and_si128(_mm_add_epi8(x, _mm_srli_epi64(x, 4)), _mm_set1_epi8(0x0F));
+	return _mm_sad_epu8(x, _mm_setzero_si128());
+}
+
+static inline void store_lanes(Uint64* lanes, FeatureVector a) { _mm_storeu_si128((__m128i*)lanes, a); }
+
+#elif !defined(BOARD_FEATURES_NO_SIMD) && defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#define FEATURE_LANES 2
+typedef v128_t FeatureVector;
+
+static inline FeatureVector load_rows(const Uint64* const* boards, int row) {
+	return wasm_u64x2_make(boards[0][row], boards[1][row]);
+}
+static inline FeatureVector splat(Uint64 bits) { return wasm_u64x2_splat(bits); }
+static inline FeatureVector vec_and(FeatureVector a, FeatureVector b) { return wasm_v128_and(a, b); }
+static inline FeatureVector vec_or(FeatureVector a, FeatureVector b) { return wasm_v128_or(a, b); }
+static inline FeatureVector vec_xor(FeatureVector a, FeatureVector b) { return wasm_v128_xor(a, b); }
+static inline FeatureVector vec_and_not(FeatureVector a, FeatureVector b) { return wasm_v128_andnot(b, a); } // ~a & b
+static inline FeatureVector vec_add(FeatureVector a, FeatureVector b) { return wasm_i64x2_add(a, b); }
+static inline FeatureVector shift_left_1(FeatureVector a) { return wasm_i64x2_shl(a, 1); }
+static inline FeatureVector shift_right_1(FeatureVector a) { return wasm_u64x2_shr(a, 1); }
+static inline FeatureVector shift_right_6(FeatureVector a) { return wasm_u64x2_shr(a, 6); }
+
+// Bit counts of each byte, then summed into each 64-bit lane
+static inline FeatureVector count_bits(FeatureVector x) {
+	x = wasm_u32x4_extadd_pairwise_u16x8(wasm_u16x8_extadd_pairwise_u8x16(wasm_i8x16_popcnt(x)));
+	return wasm_i64x2_add(wasm_v128_and(x, wasm_u64x2_splat(0xFFFFFFFF)), wasm_u64x2_shr(x, 32));
+}
+
+static inline void store_lanes(Uint64* lanes, FeatureVector a) { wasm_v128_store(lanes, a); }
+
+#endif
+
+#ifdef FEATURE_LANES
+// FEATURE_LANES boards at a time, one per lane. Only for boards that fit in one word per row.
+static void get_lane_features(const Uint64* const* boards, int width, int height, BoardFeatures* features) {
+	Uint64 full_bits = width == 64 ? ~(Uint64)0 : ((Uint64)1 << width) - 1;
+	const FeatureVector full = splat(full_bits);
+	const FeatureVector pairs = splat(full_bits >> 1); // Bit c stands for columns c and c + 1
+	const FeatureVector left_wall = splat(1);
+	const FeatureVector right_wall = splat((Uint64)1 << (width - 1));
+	const FeatureVector round_up = splat(63);
+
+	FeatureVector zero = splat(0);
+	FeatureVector seen = zero;
+	FeatureVector previous = load_rows(boards, 0); // Nothing counts as a change above the top row
+	FeatureVector aggregate_height = zero, max_height = zero, holes = zero, bumpiness = zero;
+	FeatureVector row_transitions = zero, column_transitions = zero, well_depth = zero;
+	for (int row = 0; row < height; row++) {
+		FeatureVector bits = load_rows(boards, row);
+		seen = vec_or(seen, bits);
+		FeatureVector seen_count = count_bits(seen);
+		aggregate_height = vec_add(aggregate_height, seen_count);
+		max_height = vec_add(max_height, shift_right_6(vec_add(seen_count, round_up))); // 1 once any column has started
+		holes = vec_add(holes, count_bits(vec_and_not(bits, seen)));
+		bumpiness = vec_add(bumpiness, count_bits(vec_and(vec_xor(seen, shift_right_1(seen)), pairs)));
+		row_transitions = vec_add(row_transitions, count_bits(vec_and(vec_xor(bits, shift_right_1(bits)), pairs)));
+		// Each wall on its own, as on a board one column wide they are the same cell
+		row_transitions = vec_add(row_transitions, count_bits(vec_and_not(bits, left_wall)));
+		row_transitions = vec_add(row_transitions, count_bits(vec_and_not(bits, right_wall)));
+		column_transitions = vec_add(column_transitions, count_bits(vec_xor(bits, previous)));
+		FeatureVector walled = vec_and(vec_or(shift_left_1(bits), left_wall), vec_or(shift_right_1(bits), right_wall));
+		well_depth = vec_add(well_depth, count_bits(vec_and(vec_and_not(seen, full), walled)));
+		previous = bits;
+	}
+	column_transitions = vec_add(column_transitions, count_bits(vec_and_not(previous, full)));
+
+	Uint64 lanes[7][FEATURE_LANES];
+	store_lanes(lanes[0], aggregate_height);
+	store_lanes(lanes[1], max_height);
+	store_lanes(lanes[2], holes);
+	store_lanes(lanes[3], bumpiness);
+	store_lanes(lanes[4], row_transitions);
+	store_lanes(lanes[5], column_transitions);
+	store_lanes(lanes[6], well_depth);
+	for (int i = 0; i < FEATURE_LANES; i++) {
+		features[i] = (BoardFeatures){
+			(int)lanes[0][i], (int)lanes[1][i], (int)lanes[2][i], (int)lanes[3][i], (int)lanes[4][i], (int)lanes[5][i], (int)lanes[6][i]
+		};
+	}
+}
+#endif
+
+// The same measurements one board at a time, for boards of any width. Shifts carry bits across word boundaries.
+static void get_wide_features(const Uint64* board, int width, int height, BoardFeatures* features) {
+	int row_words = GRID_ROW_WORDS(width);
+	int last = row_words - 1;
+	Uint64 last_bits = width % 64 ? ((Uint64)1 << (width % 64)) - 1 : ~(Uint64)0;
+	Uint64 right_wall = (Uint64)1 << ((width - 1) % 64);
+	Uint64 seen[GRID_ROW_WORDS(MAX_GRID_WIDTH)] = { 0 };
+	*features = (BoardFeatures){ 0 };
+
+	for (int row = 0; row < height; row++) {
+		const Uint64* bits = board + (size_t)row * row_words;
+		const Uint64* previous = row > 0 ? bits - row_words : bits;
+		bool any_seen = false;
+		for (int w = 0; w < row_words; w++) {
+			seen[w] |= bits[w];
+			any_seen |= seen[w] != 0;
+		}
+		features->max_height += any_seen;
+		for (int w = 0; w < row_words; w++) {
+			Uint64 full = w == last ? last_bits : ~(Uint64)0;
+			Uint64 pairs = w == last ? last_bits >> 1 : ~(Uint64)0;
+			Uint64 next_bits = w < last ? bits[w + 1] : 0;
+			Uint64 next_seen = w < last ? seen[w + 1] : 0;
+			Uint64 right = (bits[w] >> 1) | (next_bits << 63) | (w == last ? right_wall : 0);
+			Uint64 left = (bits[w] << 1) | (w > 0 ? bits[w - 1] >> 63 : 1);
+			Uint64 seen_right = (seen[w] >> 1) | (next_seen << 63);
+
+			features->aggregate_height += count_set_bits(seen[w]);
+			features->holes += count_set_bits(seen[w] & ~bits[w]);
+			features->bumpiness += count_set_bits((seen[w] ^ seen_right) & pairs);
+			features->row_transitions += count_set_bits((bits[w] ^ right) & pairs);
+			features->column_transitions += count_set_bits(bits[w] ^ previous[w]);
+			features->well_depth += count_set_bits(~seen[w] & full & left & right);
+		}
+		features->row_transitions += !(bits[0] & 1) + !(bits[last] & right_wall);
+	}
+	const Uint64* bottom = board + (size_t)(height - 1) * row_words;
+	for (int w = 0; w < row_words; w++) {
+		features->column_transitions += count_set_bits(~bottom[w] & (w == last ? last_bits : ~(Uint64)0));
+	}
+}
+
+void get_board_features(const Uint64* const* boards, int count, int width, int height, BoardFeatures* features) {
+	int i = 0;
+#ifdef FEATURE_LANES
+	if (width <= 64) {
+		for (; i + FEATURE_LANES <= count; i += FEATURE_LANES) {
+			get_lane_features(boards + i, width, height, features + i);
+		}
+		if (i < count) {
+			// Fill the spare lanes with copies of the last board and keep only the real results
+			const Uint64* tail_boards[FEATURE_LANES];
+			BoardFeatures tail_features[FEATURE_LANES];
+			for (int lane = 0; lane < FEATURE_LANES; lane++) {
+				tail_boards[lane] = boards[MIN(i + lane, count - 1)];
+			}
+			get_lane_features(tail_boards, width, height, tail_features);
+			memcpy(features + i, tail_features, sizeof(BoardFeatures) * (count - i));
+			i = count;
+		}
+	}
+#endif
+	for (; i < count; i++) {
+		get_wide_features(boards[i], width, height, &features[i]);
+	}
+}
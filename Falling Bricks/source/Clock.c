@@ -0,0 +1,52 @@
+#include "Clock.h"
+#include "Constants.h"
+#include <stdio.h>
+
+// Splits the division so counters running at nanosecond frequencies don't overflow when multiplied up
+static Uint64 get_microseconds(Uint64 elapsed) {
+	Uint64 frequency = SDL_GetPerformanceFrequency();
+	return elapsed / frequency * 1000000 + elapsed % frequency * 1000000 / frequency;
+}
+
+void init_real_clock(Clock* clock) {
+	*clock = (Clock){ CLOCK_REAL, SDL_GetPerformanceCounter(), 0, 1 };
+}
+
+void init_virtual_clock(Clock* clock, Uint64 start) {
+	*clock = (Clock){ CLOCK_VIRTUAL, 0, start, 1 };
+}
+
+void init_scaled_clock(Clock* clock, Uint32 scale) {
+	*clock = (Clock){ CLOCK_SCALED, SDL_GetPerformanceCounter(), 0, MAX(1, scale) };
+}
+
+Uint64 get_clock_time(const Clock* clock) {
+	if (clock->type == CLOCK_VIRTUAL) {
+		return clock->base;
+	}
+	return clock->base + get_microseconds(SDL_GetPerformanceCounter() - clock->origin) * clock->scale;
+}
+
+Uint64 get_clock_ms(const Clock* clock) {
+	return get_clock_time(clock) / 1000;
+}
+
+bool advance_clock(Clock* clock, Uint64 microseconds) {
+	if (clock->type != CLOCK_VIRTUAL) {
+		fprintf(stderr, "Error: Only a virtual clock can be advanced\n");
+		return false;
+	}
+	clock->base += microseconds;
+	return true;
+}
+
+void set_clock_scale(Clock* clock, Uint32 scale) {
+	if (clock->type != CLOCK_SCALED) {
+		fprintf(stderr, "Error: Only a scaled clock can change speed\n");
+		return;
+	}
+	Uint64 counter = SDL_GetPerformanceCounter();
+	clock->base += get_microseconds(counter - clock->origin) * clock->scale;
+	clock->origin = counter;
+	clock->scale = MAX(1, scale);
+}
@@ -1,6 +1,14 @@
 #include "DynamicArray.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+static int index_slot(const DynamicArray* array, const void* item);
+static int find_index_slot(const DynamicArray* array, const void* item);
+static void index_item(DynamicArray* array, void* item, int position);
+static void unindex_slot(DynamicArray* array, int slot);
+static bool resize_index(DynamicArray* array, int new_capacity);
 
 DynamicArray* create_dynamic_array(int initial_capacity, void (*data_destroyer)(void*)) {
 	if (initial_capacity <= 0) {
@@ -21,36 +29,86 @@ DynamicArray* create_dynamic_array(int initial_capacity, void (*data_destroyer)(
     array->size = 0;
     array->capacity = initial_capacity;
 	array->data_destroyer = data_destroyer;
+	array->unordered = false;
+	array->index_items = NULL;
+	array->index_positions = NULL;
+	array->index_capacity = 0;
     return array;
 }
 
-void add_to_dynamic_array(DynamicArray* array, void* item) {
+DynamicArray* create_indexed_dynamic_array(int initial_capacity, void (*data_destroyer)(void*), bool unordered) {
+	DynamicArray* array = create_dynamic_array(initial_capacity, data_destroyer);
+	if (!array) {
+		return NULL;
+	}
+	array->unordered = unordered;
+	if (!resize_index(array, initial_capacity)) {
+		destroy_dynamic_array(array);
+		return NULL;
+	}
+	return array;
+}
+
+bool add_to_dynamic_array(DynamicArray* array, void* item) {
     if (array->size >= array->capacity) {
-        // Double the capacity
+        // Double the capacity. The index grows first, so a failure leaves the array as it was.
         int new_capacity = array->capacity * 2;
+        if (array->index_items && !resize_index(array, new_capacity)) {
+            return false;
+        }
         void** new_items = realloc(array->items, sizeof(void*) * new_capacity);
         if (!new_items) {
             fprintf(stderr, "Error: Memory allocation failed during resizing\n");
-            return;
+            return false;
         }
         array->items = new_items;
         array->capacity = new_capacity;
     }
     array->items[array->size] = item;
+    if (array->index_items) {
+        index_item(array, item, array->size);
+    }
     array->size++;
+    return true;
 }
 
 void remove_from_dynamic_array(DynamicArray* array, void* item) {
-    for (int i = 0; i < array->size; i++) {
-        if (array->items[i] == item) {
-            // Shift elements left
-            for (int j = i; j < array->size - 1; j++) {
-                array->items[j] = array->items[j + 1];
-            }
-            array->size--;
-            return;
-        }
-    }
+	int i = -1;
+	if (array->index_items) {
+		int slot = find_index_slot(array, item);
+		if (slot < 0) return;
+		i = array->index_positions[slot];
+		unindex_slot(array, slot);
+	}
+	else {
+		for (int j = 0; j < array->size; j++) {
+			if (array->items[j] == item) {
+				i = j;
+				break;
+			}
+		}
+		if (i < 0) return;
+	}
+
+	array->size--;
+	if (array->unordered) {
+		// Fill the gap with the last item
+		if (i < array->size) {
+			array->items[i] = array->items[array->size];
+			if (array->index_items) {
+				array->index_positions[find_index_slot(array, array->items[i])] = i;
+			}
+		}
+		return;
+	}
+
+	// Shift elements left
+	for (int j = i; j < array->size; j++) {
+		array->items[j] = array->items[j + 1];
+		if (array->index_items) {
+			array->index_positions[find_index_slot(array, array->items[j])] = j;
+		}
+	}
 }
 
 void* get_from_dynamic_array(const DynamicArray* array, int index) {
@@ -65,9 +123,27 @@ void clear_dynamic_array(DynamicArray* array) {
 		}
 	}
 	array->size = 0;
+	if (array->index_items) {
+		memset(array->index_items, 0, sizeof(void*) * array->index_capacity);
+	}
+}
+
+void empty_dynamic_array(DynamicArray* array) {
+	if (array->index_items) {
+		for (int i = 0; i < array->size; i++) {
+			int slot = find_index_slot(array, array->items[i]);
+			if (slot >= 0) {
+				unindex_slot(array, slot);
+			}
+		}
+	}
+	array->size = 0;
 }
 
 bool dynamic_array_contains(const DynamicArray* array, const void* item) {
+	if (array->index_items) {
+		return find_index_slot(array, item) >= 0;
+	}
 	for (int i = 0; i < array->size; i++) {
 		if (array->items[i] == item) {
 			return true;
@@ -85,6 +161,86 @@ void destroy_dynamic_array(DynamicArray* array) {
         }
     }
 
+    free(array->index_items);
+    free(array->index_positions);
     free(array->items);
     free(array);
+}
+
+// Home slot of an item in the index, mixing the pointer bits so aligned addresses spread out
+static int index_slot(const DynamicArray* array, const void* item) {
+	uint64_t key = (uint64_t)(uintptr_t)item;
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	return (int)(key & (uint64_t)(array->index_capacity - 1));
+}
+
+// Returns the index slot holding item, or -1 if the item isn't in the array
+static int find_index_slot(const DynamicArray* array, const void* item) {
+	if (!item) return -1;
+	int mask = array->index_capacity - 1;
+	for (int slot = index_slot(array, item); array->index_items[slot]; slot = (slot + 1) & mask) {
+		if (array->index_items[slot] == item) {
+			return slot;
+		}
+	}
+	return -1;
+}
+
+static void index_item(DynamicArray* array, void* item, int position) {
+	if (!item) return;
+	int mask = array->index_capacity - 1;
+	int slot = index_slot(array, item);
+	while (array->index_items[slot]) {
+		slot = (slot + 1) & mask;
+	}
+	array->index_items[slot] = item;
+	array->index_positions[slot] = position;
+}
+
+// Linear probing removal: shift later entries of the probe run back so no tombstones are needed
+static void unindex_slot(DynamicArray* array, int slot) {
+	int mask = array->index_capacity - 1;
+	int next = (slot + 1) & mask;
+	while (array->index_items[next]) {
+		int home = index_slot(array, array->index_items[next]);
+		// Move the entry into the gap unless its home lies cyclically between the gap and its current slot
+		if (((next - home) & mask) >= ((next - slot) & mask)) {
+			array->index_items[slot] = array->index_items[next];
+			array->index_positions[slot] = array->index_positions[next];
+			slot = next;
+		}
+		next = (next + 1) & mask;
+	}
+	array->index_items[slot] = NULL;
+}
+
+// Grows the index to at least twice new_capacity so probe runs stay short, then reinserts every item
+static bool resize_index(DynamicArray* array, int new_capacity) {
+	int index_capacity = 16;
+	while (index_capacity < new_capacity * 2) {
+		index_capacity *= 2;
+	}
+	if (index_capacity == array->index_capacity) {
+		return true;
+	}
+
+	void** index_items = calloc(index_capacity, sizeof(void*));
+	int* index_positions = malloc(sizeof(int) * index_capacity);
+	if (!index_items || !index_positions) {
+		fprintf(stderr, "Error: Memory allocation failed for array index\n");
+		free(index_items);
+		free(index_positions);
+		return false;
+	}
+	free(array->index_items);
+	free(array->index_positions);
+	array->index_items = index_items;
+	array->index_positions = index_positions;
+	array->index_capacity = index_capacity;
+	for (int i = 0; i < array->size; i++) {
+		index_item(array, array->items[i], i);
+	}
+	return true;
 }
\ No newline at end of file
@@ -8,10 +8,10 @@
 #include "Constants.h"
 #include "Paths.h"
 #include "ToggleIcon.h"
-#include "Grid.h"
-#include "Piece.h"
-#include "Queue.h"
-#include "DynamicArray.h"
+#include "GameCore.h"
+#include "AiPlayer.h"
+#include "Replay.h"
+#include "GridRenderer.h"
 #include "Menu.h"
 #include "Label.h"
 #include "AlphaFade.h"
@@ -20,16 +20,49 @@
 #include "AudioContext.h"
 #include "FontContext.h"
 #include "Game.h"
-
-int last_frame_time = 0;
+#include "Clock.h"
+#include "InputQueue.h"
+#include "AutoRepeat.h"
+
+// The game steps in fixed ticks of GAME_TICK_TIME on game_clock, which runs faster while fast forwarding a replay.
+// The time it moves on by builds up here and is spent a tick at a time. Frames and the menu follow frame_clock.
+Clock frame_clock;
+Clock game_clock;
+Uint64 last_frame_time = 0; // us on frame_clock
+Uint64 last_game_time = 0; // us on game_clock
+Uint64 tick_accumulator = 0;
 
 ResolutionContext resolution_context;
 
-Piece* player_piece = NULL;
-Grid* game_board = NULL;
-
-Grid* queue_grid = NULL;
-Queue* next_pieces = NULL;
+GameCore* game = NULL;
+int board_width = BOARD_WIDTH;
+int board_height = BOARD_HEIGHT;
+Uint64 game_seed = 0;
+PieceRandomizer piece_randomizer = RANDOMIZER_UNIFORM;
+Random game_seeds; // Each game is seeded from here, so its replay can start it the same way
+
+// Every game is recorded to record_directory when it is set, and streamed to disk on the writer's thread
+const char* record_directory = NULL;
+ReplayRecorder* replay_recorder = NULL;
+ReplayWriter* replay_writer = NULL;
+char replay_path[FILENAME_MAX];
+
+// A replay being watched instead of played. Its steps come from the recording rather than the keyboard and clock.
+Uint8* replay_data = NULL;
+ReplayPlayer replay_player;
+bool watching_replay = false;
+int replay_speed = 1; // Scale of game_clock while watching
+Sint64 replay_time_owed = 0; // Game time in ms the replay is behind the ticks that have passed
+
+// Key presses waiting for the tick they happened in
+InputQueue* input_queue = NULL;
+// Repeats the movement keys while they're held
+AutoRepeatSettings auto_repeat_settings = { AUTO_REPEAT_DEFAULT_DAS, AUTO_REPEAT_DEFAULT_ARR, AUTO_REPEAT_DEFAULT_SOFT_DROP_FACTOR };
+AutoRepeat auto_repeat;
+
+// Plays instead of the keyboard while enabled. Created the first time it is needed.
+AiPlayer* ai_player = NULL;
+bool ai_enabled = false;
 
 //SDL_Renderer* debug_renderer = NULL;
 
@@ -38,92 +71,6 @@ struct GameOverMenu* game_over_menu = NULL;
 ToggleIcon* music_icon = NULL;
 ToggleIcon* sound_icon = NULL;
 
-typedef enum {
-	GAME_STATE_MENU,
-	GAME_OVER_MENU,
-	GAME_STATE_PLAYING,
-	GAME_STATE_COUNTDOWN,
-	GAME_STATE_PAUSED
-} GameState;
-
-typedef enum {
-	FOURTY_LINES,
-	BLITZ,
-	ENDLESS
-} GameMode;
-
-struct Game {
-	GameState current_state;
-	GameMode current_mode;
-	int score;
-	int total_lines_cleared;
-	int level;
-	int lines_cleared_this_level;
-	Uint32 last_player_drop_time;
-	Uint32 start_time;
-	Uint32 row_clear_start_time;
-	Uint32 total_row_clear_time;
-	Uint32 elapsed_time;
-	int current_lines_cleared;
-	char main_label[20];
-	Uint32 label_display_start_time;
-	Uint32 level_up_label_display_start_time;
-	Uint32 combo_label_display_start_time;
-	int countdown;
-	Uint32 drop_delay;
-	int required_lines_level_up;
-	Uint32 game_pause_start_time;
-	Uint32 total_pause_time;
-} game = { 0 };
-
-struct Flags {
-	bool move_player_down;
-	bool move_player_left;
-	bool move_player_right;
-	bool rotate_player;
-	bool clockwise_rotation;
-	bool drop_player;
-	bool check_full_rows;
-	bool dropping_pieces;
-	bool combo;
-} flags = { 0 };
-
-static void dequeue_next_player_piece() {
-	destroy_piece(player_piece);
-	player_piece = dequeue(next_pieces);
-	player_piece->row_pos = 0;
-	player_piece->col_pos = game_board->width / 2 - player_piece->width / 2;
-
-	enqueue(next_pieces, create_random_piece());
-	// Update queue grid
-	clear_grid(queue_grid);
-	Node* current = next_pieces->front;
-	for (int i = 0; i < next_pieces->size; i++) {
-		Piece* next_piece = (Piece*)current->data;
-		next_piece->row_pos = 3 * i + 1;
-		next_piece->col_pos = 1;
-		add_piece_to_grid(queue_grid, next_piece, true, false);
-		current = current->next;
-	}
-}
-
-static void update_drop_speed() {
-	game.drop_delay = MAX(100, BASE_DROP_DELAY * pow(0.93, (game.level - 1)));
-}
-
-static void update_level() {
-	if (game.lines_cleared_this_level >= game.required_lines_level_up) {
-		game.lines_cleared_this_level -= game.required_lines_level_up; // Reset lines cleared this level and carry over the rest to next level
-		game.required_lines_level_up = BASE_LINES_PER_LEVEL * pow(1.1, game.level++); // Increase the number of lines needed for next level, then increment level
-		game.level_up_label_display_start_time = SDL_GetTicks();
-		update_drop_speed();
-	}
-}
-
-static void calculate_score() {
-	game.score += game.current_lines_cleared * BASE_LINE_SCORE * game.current_lines_cleared * game.level * (flags.combo ? COMBO_MULTIPLIER : 1);
-}
-
 //static void screenshot_debug() {
 //	char buffer[100];
 //	sprintf_s(buffer, sizeof(buffer), "%d.bmp", (int)SDL_GetTicks());
@@ -133,74 +80,54 @@ static void calculate_score() {
 //	SDL_FreeSurface(sshot);
 //}
 
-void start_game() {
-	game.last_player_drop_time = game.start_time = SDL_GetTicks();
-	game.current_state = GAME_STATE_PLAYING;
-	dequeue_next_player_piece();
-	play_random_music();
+// Hands what has been recorded so far to the writer. The first chunk of a game starts its file.
+static void flush_recording() {
+	const Uint8* data;
+	size_t size = take_replay_chunk(replay_recorder, &data);
+	if (size) {
+		queue_replay_write(replay_writer, replay_path, data, size, data == replay_recorder->data);
+	}
+}
+
+static void finish_recording() {
+	if (replay_recorder && replay_recorder->recording) {
+		end_replay(replay_recorder, game);
+		flush_recording();
+	}
 }
 
-void prepare_game() {
-	game.main_label[0] = '\0';
-	for (int i = 0; i < 6; i++) {
-		Piece* new_piece = create_random_piece();
-		new_piece->row_pos = 3 * i + 1;
-		new_piece->col_pos = 1;
-		enqueue(next_pieces, new_piece);
-		add_piece_to_grid(queue_grid, new_piece, true, false);
-	}
-	game.level = 1;
-	game.score = 0;
-	game.total_lines_cleared = 0;
-	game.lines_cleared_this_level = 0;
-	game.elapsed_time = 0;
-	game.total_row_clear_time = 0;
-	game.countdown = 3;
-	game.total_pause_time = 0;
-	game.drop_delay = BASE_DROP_DELAY;
-	game.required_lines_level_up = BASE_LINES_PER_LEVEL;
-	game.level_up_label_display_start_time = SDL_GetTicks() - LEVEL_UP_LABEL_DISPLAY_DURATION; // Prevents showing the label at start of game
-	game.combo_label_display_start_time = SDL_GetTicks() - COMBO_LABEL_DISPLAY_DURATION; // Prevents showing the label at start of game
-	game.current_state = GAME_STATE_COUNTDOWN;
+static void start_game(GameMode mode) {
+	finish_recording();
+	Uint64 seed = next_random(&game_seeds);
+	seed_game_core(game, seed, piece_randomizer);
+	if (replay_recorder) {
+		snprintf(replay_path, sizeof(replay_path), "%s/%016llx.fbr", record_directory, (unsigned long long)seed);
+		begin_replay(replay_recorder, &(ReplayHeader) {
+			.seed = seed,
+			.randomizer = piece_randomizer,
+			.mode = mode,
+			.board_width = board_width,
+			.board_height = board_height
+		});
+	}
+	start_game_mode(game, mode);
 }
 
 void start_fourty_lines() {
-	game.current_mode = FOURTY_LINES;
-	prepare_game();
+	start_game(FOURTY_LINES);
 }
 
 void start_blitz() {
-	game.current_mode = BLITZ;
-	prepare_game();
+	start_game(BLITZ);
 }
 
 void start_endless() {
-	game.current_mode = ENDLESS;
-	prepare_game();
+	start_game(ENDLESS);
 }
 
 void main_menu() {
-	game.current_state = GAME_STATE_MENU;
-	clear_queue(next_pieces);
-	clear_grid(queue_grid);
-	clear_grid(game_board);
-	destroy_piece(player_piece);
-	player_piece = NULL;
-}
-
-void game_over() {
-	game.current_state = GAME_OVER_MENU;
-	flags.check_full_rows = false;
-	flags.dropping_pieces = false;
-	flags.move_player_down = false;
-	flags.move_player_left = false;
-	flags.move_player_right = false;
-	flags.rotate_player = false;
-	flags.drop_player = false;
-	snprintf(game.main_label, sizeof(game.main_label), "GAME OVER!");
-	Mix_HaltMusic();
-	Mix_HaltChannel(-1); // Stop all channels so we can play the game over sound if anything else is playing
-	play_sound(GAME_OVER_SFX);
+	finish_recording();
+	reset_game_core(game);
 }
 
 void send_quit() {
@@ -208,36 +135,75 @@ void send_quit() {
 }
 
 void play_next_music() {
-	if (game.current_state == GAME_STATE_PLAYING || game.current_state == GAME_STATE_PAUSED) {
+	if (game->current_state == GAME_STATE_PLAYING || game->current_state == GAME_STATE_PAUSED) {
 		play_random_music();
 	}
 }
 
-static bool move_player_left() {
-	if (validate_piece_at_position(game_board, player_piece, player_piece->row_pos, player_piece->col_pos - 1)) {
-		player_piece->col_pos--;
-		return true;
+// Takes effect when setup creates the board
+bool set_board_size(int width, int height) {
+	if (width < MIN_BOARD_WIDTH || width > MAX_BOARD_WIDTH || height < MIN_BOARD_HEIGHT || height > MAX_BOARD_HEIGHT) {
+		fprintf(stderr, "Error: Board size must be between %dx%d and %dx%d\n", MIN_BOARD_WIDTH, MIN_BOARD_HEIGHT, MAX_BOARD_WIDTH, MAX_BOARD_HEIGHT);
+		return false;
 	}
-	return false;
+	board_width = width;
+	board_height = height;
+	return true;
 }
 
-static bool move_player_right() {
-	if (validate_piece_at_position(game_board, player_piece, player_piece->row_pos, player_piece->col_pos + 1)) {
-		player_piece->col_pos++;
-		return true;
-	}
-	return false;
+// Everything random in a session follows from this seed. Takes effect when setup runs.
+void set_game_seed(Uint64 seed) {
+	game_seed = seed;
 }
 
-static bool move_player_down() {
-	if (validate_piece_at_position(game_board, player_piece, player_piece->row_pos + 1, player_piece->col_pos)) {
-		player_piece->row_pos++;
-		return true;
+void set_bag_randomizer(bool enabled) {
+	piece_randomizer = enabled ? RANDOMIZER_BAG : RANDOMIZER_UNIFORM;
+}
+
+void set_ai_enabled(bool enabled) {
+	ai_enabled = enabled;
+}
+
+void set_record_directory(const char* directory) {
+	record_directory = directory;
+}
+
+bool set_replay_file(const char* path) {
+	size_t size;
+	Uint8* data = load_replay_file(path, &size);
+	if (!data) {
+		return false;
+	}
+	if (!open_replay(&replay_player, data, size) || !set_board_size(replay_player.header.board_width, replay_player.header.board_height)) {
+		free(data);
+		return false;
 	}
-	return false;
+	free(replay_data);
+	replay_data = data;
+	watching_replay = true;
+	return true;
+}
+
+void set_auto_repeat_delay(int delay) {
+	auto_repeat_settings.das = MAX(0, delay);
+}
+
+void set_auto_repeat_rate(int rate) {
+	auto_repeat_settings.arr = MAX(0, rate);
+}
+
+void set_soft_drop_factor(int factor) {
+	auto_repeat_settings.soft_drop_factor = MAX(1, factor);
+}
+
+void set_replay_speed(int speed) {
+	replay_speed = MAX(1, speed);
 }
 
 bool setup() {
+	init_real_clock(&frame_clock);
+	init_scaled_clock(&game_clock, watching_replay ? replay_speed : 1);
+
 	music_icon = create_toggle_icon((SDL_Rect) { WINDOW_WIDTH - 35, 5, 30, 30 }, MUSIC_ICON_ON, MUSIC_ICON_OFF);
 	sound_icon = create_toggle_icon((SDL_Rect) { WINDOW_WIDTH - 70, 5, 30, 30 },SOUND_ICON_ON, SOUND_ICON_OFF);
 	if (!music_icon || !sound_icon) {
@@ -252,7 +218,7 @@ bool setup() {
 		return false;
 	}
 
-	if (!create_audio_context()) {
+	if (!create_audio_context(game_seed + 1)) {
 		fprintf(stderr, "Error: Failed to create audio context\n");
 		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "MISSING AUDIO", "Failed to load required audio files.", 0);
 		return false;
@@ -266,50 +232,95 @@ bool setup() {
 		start_blitz,
 		start_endless,
 		send_quit
-	});
+	}, game_seed + 2, &frame_clock);
 
 	game_over_menu = create_game_over_menu((ButtonCallback[]) {
 		main_menu,
 		send_quit
 	});
 
-	game_board = create_grid(BOARD_WIDTH, BOARD_HEIGHT, true, true);
+	game = create_game_core(board_width, board_height, game_seed);
+	input_queue = create_input_queue();
+	init_auto_repeat(&auto_repeat, &auto_repeat_settings);
 
-	queue_grid = create_grid(6, 19, true,false);
-	queue_grid->show_grid_lines = false;
-
-	next_pieces = create_queue(destroy_piece);
-
-	if (!game_board || !queue_grid || !title_menu || !game_over_menu)
+	if (!game || !input_queue || !title_menu || !game_over_menu)
 	{
 		fprintf(stderr, "Fatal Error during game setup\n"); 
 		return false;
 	}
-	
+	seed_random(&game_seeds, game_seed);
+
+	if (record_directory) {
+		replay_recorder = create_replay_recorder();
+		replay_writer = create_replay_writer();
+		if (!replay_recorder || !replay_writer) {
+			fprintf(stderr, "Error: Failed to start recording replays\n");
+			return false;
+		}
+	}
+	if (watching_replay) {
+		seed_game_core(game, replay_player.header.seed, replay_player.header.randomizer);
+		start_game_mode(game, replay_player.header.mode);
+	}
+
 	return true;
 }
 
 void cleanup() {
-	destroy_piece(player_piece);
-	destroy_grid(game_board);
-	destroy_grid(queue_grid);
-	destroy_queue(next_pieces);
+#ifdef _DEBUG
+	if (game) {
+		print_piece_pool_stats(game->piece_pool, "Game");
+		print_piece_pool_stats(game->board->piece_pool, "Board");
+	}
+#endif
+	if (game) {
+		finish_recording();
+	}
+	if (input_queue) {
+		print_input_latency(input_queue);
+	}
+	destroy_input_queue(input_queue);
+	destroy_replay_writer(replay_writer); // Waits for the last writes
+	destroy_replay_recorder(replay_recorder);
+	free(replay_data);
+	destroy_ai_player(ai_player);
+	destroy_game_core(game);
 	destroy_title_menu(title_menu);
 	destroy_game_over_menu(game_over_menu);
 	destroy_audio_context();
 	destroy_font_context();
 	destroy_toggle_icon(music_icon);
 	destroy_toggle_icon(sound_icon);
-	player_piece = NULL;
-	game_board = NULL;
-	queue_grid = NULL;
-	next_pieces = NULL;
+	input_queue = NULL;
+	replay_writer = NULL;
+	replay_recorder = NULL;
+	replay_data = NULL;
+	watching_replay = false;
+	ai_player = NULL;
+	game = NULL;
 	title_menu = NULL;
 	game_over_menu = NULL;
 	music_icon = NULL;
 	sound_icon = NULL;
 }
 
+// Queues a key press or release for the tick it happened in. SDL stamps events with its own millisecond ticks, so how
+// long ago the key went down or up is measured on those and then taken off both of the game's clocks.
+static void queue_key_event(Uint32 timestamp, const GameInputs* key_inputs, bool released) {
+	Uint64 age = (Uint64)MIN(SDL_GetTicks() - timestamp, 1000) * 1000; // Events without a real timestamp count as a second old
+	Uint64 game_now = get_clock_time(&game_clock);
+	Uint64 real_now = get_clock_time(&frame_clock);
+	InputEvent event = {
+		.time = game_now - MIN(game_now, age * game_clock.scale),
+		.real_time = real_now - MIN(real_now, age),
+		.inputs = *key_inputs,
+		.released = released
+	};
+	if (!push_input_event(input_queue, &event)) {
+		fprintf(stderr, "Error: Input queue is full, dropped a key %s\n", released ? "release" : "press");
+	}
+}
+
 void process_input(bool* running) {
 	SDL_Event event;
 	while(SDL_PollEvent(&event)) {
@@ -332,16 +343,30 @@ void process_input(bool* running) {
 			return;
 		}
 
-		if (game.current_state == GAME_STATE_MENU) {
+		if (game->current_state == GAME_STATE_MENU) {
 			handle_title_menu_events(title_menu, event);
 		}
-		if (game.current_state == GAME_OVER_MENU) {
+		if (game->current_state == GAME_OVER_MENU) {
 			handle_game_over_menu_events(game_over_menu, event);
 		}
 
 		AudioContext* audio_context = get_audio_context();
 
-		if (event.type == SDL_KEYDOWN) {
+		// Held keys repeat at the game's own rates, so the keyboard's repeats are ignored
+		if (event.type == SDL_KEYUP && !watching_replay) {
+			// Released in any state, so a key let go in a menu doesn't keep repeating in the next game
+			int key = event.key.keysym.sym;
+			GameInputs released = {
+				.move_left = key == SDLK_LEFT,
+				.move_right = key == SDLK_RIGHT,
+				.move_down = key == SDLK_DOWN
+			};
+			if (released.move_left || released.move_right || released.move_down) {
+				queue_key_event(event.key.timestamp, &released, true);
+			}
+		}
+
+		if (event.type == SDL_KEYDOWN && !event.key.repeat) {
 			int key = event.key.keysym.sym;
 			if (key == SDLK_ESCAPE) {
 				*running = false;
@@ -367,188 +392,229 @@ void process_input(bool* running) {
 				}
 			}
 
-			if (key == SDLK_p) {
-				if (game.current_state == GAME_STATE_PLAYING) {
-					game.game_pause_start_time = SDL_GetTicks();
-					game.current_state = GAME_STATE_PAUSED;
+			if (watching_replay) {
+				// The recording plays the game, F switches between normal speed and fast forward
+				if (key == SDLK_f) {
+					set_clock_scale(&game_clock, game_clock.scale > 1 ? 1 : REPLAY_FAST_FORWARD_SPEED);
 				}
-				else if (game.current_state == GAME_STATE_PAUSED) {
-					Uint32 pause_duration = SDL_GetTicks() - game.game_pause_start_time;
-					game.total_pause_time += pause_duration;
-					game.last_player_drop_time += pause_duration;
-					game.current_state = GAME_STATE_PLAYING;
+				continue;
+			}
+
+			if (key == SDLK_p) {
+				toggle_game_pause(game);
+				if (replay_recorder) {
+					record_replay_pause(replay_recorder);
 				}
 			}
+			if (key == SDLK_a) {
+				set_ai_enabled(!ai_enabled);
+			}
 
-			if (game.current_state == GAME_STATE_PLAYING) {
+			if (game->current_state == GAME_STATE_PLAYING) {
+				GameInputs inputs = { 0 };
 				if (key == SDLK_UP || key == SDLK_x) {
-					flags.rotate_player = true;
-					flags.clockwise_rotation = true;
+					inputs.rotate = true;
+					inputs.clockwise = true;
 				}
 				else if (key == SDLK_z) {
-					flags.rotate_player = true;
-					flags.clockwise_rotation = false;
+					inputs.rotate = true;
+					inputs.clockwise = false;
 				}
 				else if (key == SDLK_DOWN) {
-					flags.move_player_down = true;
+					inputs.move_down = true;
 				}
 				else if (key == SDLK_LEFT) {
-					flags.move_player_left = true;
+					inputs.move_left = true;
 				}
 				else if (key == SDLK_RIGHT) {
-					flags.move_player_right = true;
+					inputs.move_right = true;
 				}
 				else if (key == SDLK_SPACE) {
-					flags.drop_player = true;
+					inputs.hard_drop = true;
+				}
+				else {
+					continue;
 				}
+				queue_key_event(event.key.timestamp, &inputs, false);
 			}
 		}
 	}
 	
 }
 
-void update() {
-	Uint32 time_now = SDL_GetTicks();
-
-	int time_to_wait = FRAME_TARGET_TIME - (time_now - last_frame_time);
+// Hands the game back to the player at normal speed, dropping any fast forwarded time still owed
+static void stop_replay() {
+	watching_replay = false;
+	set_clock_scale(&game_clock, 1);
+	tick_accumulator = 0;
+}
 
-	if (time_to_wait > 0 && time_to_wait <= FRAME_TARGET_TIME) {
-		SDL_Delay(time_to_wait);
+// Plays the recorded steps that fit in one tick. The steps keep their recorded lengths, so a replay plays at the speed
+// it was recorded whatever the tick rate was then, and faster only by game_clock running faster.
+static Uint32 step_replay() {
+	Uint32 events = 0;
+	replay_time_owed += GAME_TICK_TIME;
+	while (watching_replay && replay_time_owed > 0) {
+		GameInputs replay_inputs;
+		Uint32 replay_dt;
+		switch (read_replay_record(&replay_player, &replay_inputs, &replay_dt)) {
+		case REPLAY_STEP:
+			events |= game_step(game, &replay_inputs, replay_dt);
+			replay_time_owed -= replay_dt;
+			break;
+		case REPLAY_PAUSE:
+			toggle_game_pause(game);
+			break;
+		case REPLAY_END:
+			printf("Replay finished with score %d, %d lines in %u ms. Recorded: score %d, %d lines in %u ms.\n",
+				game->score, game->total_lines_cleared, game->elapsed_time,
+				replay_player.result.score, replay_player.result.total_lines_cleared, replay_player.result.elapsed_time);
+			stop_replay();
+			break;
+		case REPLAY_ERROR:
+			fprintf(stderr, "Error: Replay is damaged, stopped after %llu steps\n", (unsigned long long)replay_player.steps);
+			stop_replay();
+			break;
+		}
 	}
+	return events;
+}
 
-	float delta_time = (time_now - last_frame_time) / 1000.0f;
-	last_frame_time = time_now;
-
-	if (game.current_state == GAME_STATE_MENU) {
-		update_grid_positions(title_menu, delta_time);
-		return;
+// Steps the game and records the step
+static Uint32 play_step(const GameInputs* step_inputs, Uint32 dt) {
+	Uint32 events = game_step(game, step_inputs, dt);
+	if (replay_recorder && replay_recorder->recording) {
+		record_replay_step(replay_recorder, step_inputs, dt);
+		if (events & GAME_EVENT_GAME_OVER) {
+			finish_recording();
+		}
+		else if (replay_recorder->size - replay_recorder->flushed >= REPLAY_CHUNK_SIZE) {
+			flush_recording();
+		}
 	}
+	return events;
+}
 
-	if (game.current_state == GAME_STATE_PAUSED) {
-		return;
+// Inputs that might share a tick with more after them. If any come they're played first in a step of their own that
+// takes no time, otherwise they share the tick's step.
+typedef struct {
+	GameInputs inputs;
+	bool waiting;
+	bool has_press; // Made by a key press, whose latency is counted once it has been applied
+	InputEvent press;
+} PendingStep;
+
+static Uint32 play_pending_step(PendingStep* step) {
+	if (!step->waiting) {
+		return 0;
 	}
+	Uint32 events = play_step(&step->inputs, 0);
+	if (step->has_press) {
+		record_input_latency(input_queue, &step->press, get_clock_time(&frame_clock));
+	}
+	*step = (PendingStep){ 0 };
+	return events;
+}
 
-	bool lock_piece = false;
-	bool drop_player = false;
+// Advances the game by the tick that ends at tick_end on game_clock
+static Uint32 step_tick(Uint64 tick_end) {
+	if (watching_replay) {
+		return step_replay();
+	}
+	if (ai_enabled && !ai_player) {
+		// Moves at most once a frame's worth of time, as it did when the game stepped once a frame
+		AiSettings settings = get_default_ai_settings();
+		settings.input_delay = FRAME_TARGET_TIME;
+		ai_player = create_ai_player(board_width, board_height, &settings);
+		ai_enabled = ai_player != NULL;
+	}
+	GameInputs inputs = { 0 };
+	if (ai_enabled) {
+		get_ai_inputs(ai_player, game, &inputs);
+	}
 
-	if (game.current_state == GAME_STATE_COUNTDOWN) {
-		if (time_now - game.label_display_start_time >= COUNTDOWN_DISPLAY_DURATION) {
-			snprintf(game.main_label, sizeof(game.main_label), "%d", game.countdown);
-			game.label_display_start_time = time_now;
-			if (game.countdown <= 0) {
-				snprintf(game.main_label, sizeof(game.main_label), "GO!");
-				start_game();
-			}
-			game.countdown--;
-		}
-		return;
-	}
-
-	AudioContext* audio_context = get_audio_context();
-
-	if (game.current_state == GAME_STATE_PLAYING) {
-
-		update_level();
-		if (flags.check_full_rows) {
-			// Check for full rows
-			game.current_lines_cleared = check_and_mark_full_rows(game_board);
-			if (game.current_lines_cleared > 0) {
-				flags.dropping_pieces = true;
-				game.row_clear_start_time = time_now;
-				game.total_lines_cleared += game.current_lines_cleared;
-				game.lines_cleared_this_level += game.current_lines_cleared;
-				calculate_score();
-				char* label = get_row_clear_label(game.current_lines_cleared);
-				snprintf(game.main_label, sizeof(game.main_label), "%s", label);
-				game.label_display_start_time = time_now;
-				game.combo_label_display_start_time = flags.combo ? time_now : 0;
-				play_sound(CLEAR_SFX);
-			}
-			flags.combo = false;
-			flags.check_full_rows = false;
-			return;
-		}
-		if (flags.dropping_pieces) {
-			if (time_now - game.row_clear_start_time >= ROW_CLEAR_TIME) {
-				clear_full_rows(game_board);
-				drop_all_pieces(game_board);
-				game.total_row_clear_time += time_now - game.row_clear_start_time;
-				game.last_player_drop_time = time_now;
-				flags.dropping_pieces = false;
-				// Check for full rows again
-				flags.check_full_rows = true;
-				flags.combo = true;
-			}
-			return;
-		}
-		game.elapsed_time = time_now - game.start_time - game.total_row_clear_time - game.total_pause_time;
-		bool time_up = game.current_mode == BLITZ && game.elapsed_time > BLITZ_TIME;
-		bool reached_line_limit = game.current_mode == FOURTY_LINES && game.total_lines_cleared >= 40;
-		if ( time_up || reached_line_limit) {
-			if (time_up) {
-				game.elapsed_time = BLITZ_TIME;
-			}
-			game_over();
-			return;
-		}
-		if (player_piece == NULL) {
-			dequeue_next_player_piece();
+	// Every key pressed before the end of the tick is applied in it, then every held key repeat that is due, each in a
+	// step of its own so none are merged. The last of them shares the tick's step.
+	Uint32 events = 0;
+	PendingStep pending = { 0 };
+	InputEvent event;
+	while (pop_input_event_before(input_queue, tick_end, &event)) {
+		if (event.released) {
+			release_auto_repeat_keys(&auto_repeat, &event.inputs, event.time);
+			continue;
 		}
+		events |= play_pending_step(&pending);
+		press_auto_repeat_keys(&auto_repeat, &event.inputs, event.time);
+		pending = (PendingStep){ event.inputs, true, true, event };
+	}
+	int shifts, drops;
+	bool to_wall;
+	take_auto_repeats(&auto_repeat, tick_end, game->drop_delay, MAX(board_width, board_height), &shifts, &drops, &to_wall);
+	for (int i = 0; i < MAX(shifts, drops); i++) {
+		events |= play_pending_step(&pending);
+		pending.inputs.move_left = i < shifts && auto_repeat.direction < 0;
+		pending.inputs.move_right = i < shifts && auto_repeat.direction > 0;
+		pending.inputs.move_down = i < drops;
+		pending.waiting = true;
+	}
 
-		if (time_now - game.last_player_drop_time >= game.drop_delay) {
-			game.last_player_drop_time = time_now;
-			flags.move_player_down = true;
-		}
+	inputs.move_down |= pending.inputs.move_down;
+	inputs.move_left |= pending.inputs.move_left;
+	inputs.move_right |= pending.inputs.move_right;
+	inputs.hard_drop |= pending.inputs.hard_drop;
+	if (pending.inputs.rotate) {
+		inputs.rotate = true;
+		inputs.clockwise = pending.inputs.clockwise;
+	}
+	inputs.shift_left |= to_wall && auto_repeat.direction < 0;
+	inputs.shift_right |= to_wall && auto_repeat.direction > 0;
+	events |= play_step(&inputs, GAME_TICK_TIME);
+	if (pending.has_press) {
+		record_input_latency(input_queue, &pending.press, get_clock_time(&frame_clock));
+	}
+	return events;
+}
 
-		if (flags.move_player_left) {
-			if (move_player_left()) {
-				play_sound(MOVE_SFX);
-			}
-			flags.move_player_left = false;
-		}
-		if (flags.move_player_right) {
-			if (move_player_right()) {
-				play_sound(MOVE_SFX);
-			}
-			flags.move_player_right = false;
-		}
-		if (flags.rotate_player) {
-			Piece* rotated_piece = try_rotate_piece(game_board, player_piece, flags.clockwise_rotation);
-			if (rotated_piece) {
-				destroy_piece(player_piece);
-				// Update to rotated piece and new position after rotation
-				player_piece = rotated_piece;
-				play_sound(MOVE_SFX);
-			}
-			flags.rotate_player = false;
-		}
-		if (flags.move_player_down) {
-			lock_piece = !move_player_down();
-			flags.move_player_down = false;
-		}
-		if (flags.drop_player) {
-			drop_player = true;
-			lock_piece = true;
-			flags.drop_player = false;
-			game.last_player_drop_time = time_now;
-		}
+void update() {
+	Uint64 frame_time = get_clock_time(&frame_clock);
+	float delta_time = (frame_time - last_frame_time) / 1000000.0f;
+	last_frame_time = frame_time;
+	Uint64 game_time = get_clock_time(&game_clock);
+	Uint64 game_time_passed = game_time - last_game_time;
+	last_game_time = game_time;
+	Uint64 tick_length = GAME_TICK_TIME * 1000;
+
+	if (game->current_state == GAME_STATE_MENU) {
+		update_grid_positions(title_menu, delta_time);
+	}
 
-		clear_unlocked_cells(game_board);
-		bool piece_added = add_piece_to_grid(game_board, player_piece, lock_piece, drop_player);
-		if (!piece_added) {
-			// If the piece can't be added, it means it has reached the top of the board
-			mark_x_cells(game_board, player_piece);
-			game_over();
-			return;
-		}
+	// A stall (a dragged window, a breakpoint) would otherwise be made up for by running the game fast afterwards
+	tick_accumulator = MIN(tick_accumulator + game_time_passed, tick_length * MAX_TICKS_PER_FRAME * game_clock.scale);
+	Uint32 events = 0;
+	while (tick_accumulator >= tick_length) {
+		tick_accumulator -= tick_length;
+		events |= step_tick(game_time - tick_accumulator);
+	}
 
-		if (lock_piece) {
-			destroy_piece(player_piece);
-			player_piece = NULL;
-			// Check for full rows on next iteration
-			flags.check_full_rows = true;
-			play_sound(LOCK_SFX);
-		}
+	if (events & GAME_EVENT_START) {
+		play_random_music();
+	}
+	if (events & GAME_EVENT_MOVE) {
+		play_sound(MOVE_SFX);
+	}
+	if (events & GAME_EVENT_LOCK) {
+		play_sound(LOCK_SFX);
+	}
+	if (events & GAME_EVENT_CLEAR) {
+		play_sound(CLEAR_SFX);
+	}
+	if (events & GAME_EVENT_GAME_OVER) {
+		// Keys pressed too late for the game that ended, and keys still repeating, mustn't carry over to the next one
+		clear_input_queue(input_queue);
+		init_auto_repeat(&auto_repeat, &auto_repeat_settings);
+		Mix_HaltMusic();
+		Mix_HaltChannel(-1); // Stop all channels so we can play the game over sound if anything else is playing
+		play_sound(GAME_OVER_SFX);
 	}
 }
 
@@ -557,10 +623,10 @@ void render(SDL_Renderer* renderer) {
 	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
 	SDL_RenderClear(renderer);
 
-	if (game.current_state == GAME_STATE_MENU) {
+	if (game->current_state == GAME_STATE_MENU) {
 		draw_title_menu(title_menu, renderer);
 	}
-	else if (game.current_state == GAME_OVER_MENU) {
+	else if (game->current_state == GAME_OVER_MENU) {
 		draw_game_over_menu(game_over_menu, renderer);
 	}
 
@@ -570,7 +636,7 @@ void render(SDL_Renderer* renderer) {
 
 	FontContext* font_context = get_font_context();
 
-	if (game.current_state == GAME_STATE_PAUSED) {
+	if (game->current_state == GAME_STATE_PAUSED) {
 		// draw pause text in middle of screen
 		LabelStyle label_style = default_label_style_no_font();
 		label_style.font = font_context->label_font;
@@ -588,37 +654,42 @@ void render(SDL_Renderer* renderer) {
 	}
 	
 	// Still want to show the game board at end of game and during countdown
-	if (game.current_state != GAME_STATE_MENU && game.current_state != GAME_STATE_PAUSED) {
+	if (game->current_state != GAME_STATE_MENU && game->current_state != GAME_STATE_PAUSED) {
 
 		float scale_factor = resolution_context.scale_factor;
 		int border_width = 4 * scale_factor;
 
-		// Board
-		int board_x = ((float)WINDOW_WIDTH / 2 - (float)CELL_SIZE * BOARD_WIDTH / 2  ) * scale_factor + resolution_context.x_offset;
-		int board_y = ((float)WINDOW_HEIGHT / 2 - (float)CELL_SIZE * BOARD_HEIGHT / 2) * scale_factor + resolution_context.y_offset;
-		int cell_width = CELL_SIZE * scale_factor;
-		draw_grid(game_board, board_x, board_y, cell_width, border_width, renderer);
+		// Board. Cells shrink so larger boards still fit, but never below a pixel.
+		float cell_size = MIN(CELL_SIZE, MIN((float)MAX_BOARD_PIXEL_WIDTH / game->board->width, (float)MAX_BOARD_PIXEL_HEIGHT / game->board->height));
+		int board_x = ((float)WINDOW_WIDTH / 2 - cell_size * game->board->width / 2) * scale_factor + resolution_context.x_offset;
+		int board_y = ((float)WINDOW_HEIGHT / 2 - cell_size * game->board->height / 2) * scale_factor + resolution_context.y_offset;
+		int cell_width = MAX(1, cell_size * scale_factor);
+		int board_pixel_height = cell_width * game->board->height;
+		// Full rows fade out while they wait to be cleared
+		Uint8 full_row_alpha = get_fade_alpha(game->row_clear_start_time, ROW_CLEAR_TIME, game->time);
+		draw_grid(game->board, board_x, board_y, cell_width, border_width, full_row_alpha, renderer);
 
 		// Level bar
-		int x_pos = 5 * scale_factor + game_board->width * cell_width + board_x;
+		int x_pos = 5 * scale_factor + game->board->width * cell_width + board_x;
 		int y_pos = board_y;
 		int w = 20 * scale_factor;
-		int h = cell_width * BOARD_HEIGHT;
-		draw_level_bar(renderer, x_pos, y_pos, w, h, border_width, game.lines_cleared_this_level, game.required_lines_level_up);
+		int h = board_pixel_height;
+		draw_level_bar(renderer, x_pos, y_pos, w, h, border_width, game->lines_cleared_this_level, game->required_lines_level_up);
 
 		x_pos += w + 5 * scale_factor;
-		// Queue grid
-		draw_grid(queue_grid, x_pos, board_y, cell_width, border_width, renderer);
+		// Upcoming pieces keep their normal size whatever the board size
+		int preview_cell_width = CELL_SIZE * scale_factor;
+		draw_piece_queue(game->piece_queue, x_pos, board_y, preview_cell_width, preview_cell_width * BOARD_HEIGHT, border_width, renderer);
 
-		// Stats
+		// Stats, kept at least as tall as for the default board so short boards leave room for them
 		int stats_board_padding = 10 * scale_factor;
 		int stats_x = board_x - stats_board_padding;
-		int stats_y = board_y + cell_width * BOARD_HEIGHT;
+		int stats_y = board_y + MAX(board_pixel_height, preview_cell_width * BOARD_HEIGHT);
 
 		int stats_vertical_offset = 15 * scale_factor;
 
 		const char* labels[] = {"SCORE", "LEVEL", "LINES", "TIME"};
-		int values[] = { game.score, game.level, game.total_lines_cleared, 0 };
+		int values[] = { game->score, game->level, game->total_lines_cleared, 0 };
 
 		LabelStyle label_style_small_font = default_label_style_no_font();
 		label_style_small_font.font = font_context->label_font_small;
@@ -632,13 +703,13 @@ void render(SDL_Renderer* renderer) {
 
 		// Easier to draw bottom to top in this case
 		for (int i = 3; i >= 0; i--) {
-			if (i == 2 && game.current_mode == FOURTY_LINES) {
+			if (i == 2 && game->current_mode == FOURTY_LINES) {
 				SDL_Rect small_label = draw_label(renderer, stats_x, stats_y, "/40", label_style_small_font);
 				stats_x -= small_label.w;
 			}
 			else if (i == 3) {
-				int time_ms = game.elapsed_time;
-				if (game.current_mode == BLITZ) {
+				int time_ms = game->elapsed_time;
+				if (game->current_mode == BLITZ) {
 					// In this case we count down from 2 minutes
 					time_ms = BLITZ_TIME - time_ms;
 					if (time_ms < 10000) {
@@ -672,20 +743,20 @@ void render(SDL_Renderer* renderer) {
 		LabelStyle label_style = default_label_style_no_font();
 		label_style.font = font_context->label_font;
 
-		if (game.current_state != GAME_OVER_MENU) {
-			int fade_duration = game.current_state == GAME_STATE_PLAYING ? ROW_LABEL_DISPLAY_DURATION : COUNTDOWN_DISPLAY_DURATION;
-			label_style.color.a = get_fade_alpha(game.label_display_start_time, fade_duration);
+		if (game->current_state != GAME_OVER_MENU) {
+			int fade_duration = game->current_state == GAME_STATE_PLAYING ? ROW_LABEL_DISPLAY_DURATION : COUNTDOWN_DISPLAY_DURATION;
+			label_style.color.a = get_fade_alpha(game->label_display_start_time, fade_duration, game->time);
 		}
-		stats_y -= draw_label(renderer, stats_x - stats_board_padding, stats_y - stats_vertical_offset, game.main_label, label_style).h + stats_vertical_offset;
+		stats_y -= draw_label(renderer, stats_x - stats_board_padding, stats_y - stats_vertical_offset, game->main_label, label_style).h + stats_vertical_offset;
 		
 		// Combo label
 		label_style.color = (SDL_Color){ 0, 255, 0, 255 };
-		label_style.color.a = get_fade_alpha(game.combo_label_display_start_time, COMBO_LABEL_DISPLAY_DURATION);
+		label_style.color.a = get_fade_alpha(game->combo_label_display_start_time, COMBO_LABEL_DISPLAY_DURATION, game->time);
 		stats_y -= draw_label(renderer, stats_x - stats_board_padding, stats_y - stats_vertical_offset, "GRAVITY COMBO!", label_style).h + stats_vertical_offset;
 
 		// Level up label
 		label_style.color = (SDL_Color){ 233, 200, 0, 255 };
-		label_style.color.a = get_fade_alpha(game.level_up_label_display_start_time, LEVEL_UP_LABEL_DISPLAY_DURATION);
+		label_style.color.a = get_fade_alpha(game->level_up_label_display_start_time, LEVEL_UP_LABEL_DISPLAY_DURATION, game->time);
 		draw_label(renderer, stats_x - stats_board_padding, stats_y - stats_vertical_offset, "LEVEL UP!", label_style);
 	}
 
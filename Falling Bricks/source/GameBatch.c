@@ -0,0 +1,232 @@
+#include "GameBatch.h"
+#include "Constants.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCHMARK_SECONDS 3.0
+#define BENCHMARK_STEP_TIME FRAME_TARGET_TIME
+
+// Bots don't need to watch the countdown, so new games go straight to playing
+static void restart_game(GameBatch* batch, GameCore* game) {
+	reset_game_core(game);
+	start_game_mode(game, batch->mode);
+	while (game->current_state == GAME_STATE_COUNTDOWN) {
+		game_step(game, NULL, COUNTDOWN_DISPLAY_DURATION);
+	}
+}
+
+// Counts in locals and adds them to the worker once, as the workers sit side by side and share cache lines
+static void step_games(GameBatch* batch, BatchWorker* worker) {
+	const GameInputs* inputs = batch->inputs;
+	Uint64 placements = 0;
+	Uint64 games_finished = 0;
+	for (int i = worker->first_game; i < worker->end_game; i++) {
+		GameCore* game = &batch->games[i];
+		if (game->current_state == GAME_OVER_MENU) {
+			restart_game(batch, game);
+			games_finished++;
+		}
+		Uint32 events = game_step(game, inputs ? &inputs[i] : NULL, batch->dt);
+		batch->events[i] = events;
+		if (events & GAME_EVENT_LOCK) {
+			placements++;
+		}
+	}
+	worker->steps += worker->end_game - worker->first_game;
+	worker->placements += placements;
+	worker->games_finished += games_finished;
+}
+
+static int batch_worker_thread(void* data) {
+	BatchWorker* worker = data;
+	GameBatch* batch = worker->batch;
+	while (true) {
+		SDL_SemWait(worker->start);
+		if (batch->quit) {
+			break;
+		}
+		step_games(batch, worker);
+		SDL_SemPost(batch->done);
+	}
+	return 0;
+}
+
+static void stop_workers(GameBatch* batch) {
+	batch->quit = true;
+	for (int i = 1; i < batch->worker_count; i++) {
+		BatchWorker* worker = &batch->workers[i];
+		if (worker->thread) {
+			SDL_SemPost(worker->start);
+			SDL_WaitThread(worker->thread, NULL);
+			worker->thread = NULL;
+		}
+	}
+}
+
+// Gives each worker an equal share of the games. Threads that fail to start leave their games to the calling thread.
+static bool start_workers(GameBatch* batch, int thread_count) {
+	batch->workers = calloc(thread_count, sizeof(BatchWorker));
+	batch->done = SDL_CreateSemaphore(0);
+	if (!batch->workers || !batch->done) {
+		fprintf(stderr, "Error: Failed to allocate batch workers\n");
+		return false;
+	}
+	batch->worker_count = 1;
+	batch->workers[0].batch = batch;
+	batch->workers[0].end_game = batch->count;
+	for (int i = 1; i < thread_count; i++) {
+		BatchWorker* worker = &batch->workers[i];
+		worker->batch = batch;
+		worker->start = SDL_CreateSemaphore(0);
+		if (!worker->start) {
+			break;
+		}
+		worker->thread = SDL_CreateThread(batch_worker_thread, "BatchWorker", worker);
+		if (!worker->thread) {
+			fprintf(stderr, "Error: Failed to start batch worker thread: %s\n", SDL_GetError());
+			SDL_DestroySemaphore(worker->start);
+			worker->start = NULL;
+			break;
+		}
+		batch->worker_count++;
+	}
+	for (int i = 0; i < batch->worker_count; i++) {
+		batch->workers[i].first_game = (int)((Sint64)batch->count * i / batch->worker_count);
+		batch->workers[i].end_game = (int)((Sint64)batch->count * (i + 1) / batch->worker_count);
+	}
+	return true;
+}
+
+GameBatch* create_game_batch(int count, int board_width, int board_height, GameMode mode, Uint64 seed, PieceRandomizer randomizer, int thread_count) {
+	if (count <= 0) {
+		fprintf(stderr, "Error: Game batch needs at least one game\n");
+		return NULL;
+	}
+	GameBatch* batch = calloc(1, sizeof(GameBatch));
+	if (!batch) {
+		fprintf(stderr, "Error: Failed to allocate memory for GameBatch\n");
+		return NULL;
+	}
+	batch->mode = mode;
+	batch->games = calloc(count, sizeof(GameCore));
+	batch->events = calloc(count, sizeof(Uint32));
+	if (!batch->games || !batch->events) {
+		fprintf(stderr, "Error: Failed to allocate memory for batch games\n");
+		destroy_game_batch(batch);
+		return NULL;
+	}
+	for (; batch->count < count; batch->count++) {
+		GameCore* game = &batch->games[batch->count];
+		if (!init_game_core(game, board_width, board_height, seed + batch->count)) {
+			destroy_game_batch(batch);
+			return NULL;
+		}
+		seed_game_core(game, seed + batch->count, randomizer);
+		restart_game(batch, game);
+	}
+
+	if (thread_count <= 0) {
+		thread_count = SDL_GetCPUCount();
+	}
+	if (!start_workers(batch, MAX(1, MIN(thread_count, count)))) {
+		destroy_game_batch(batch);
+		return NULL;
+	}
+	return batch;
+}
+
+void step_game_batch(GameBatch* batch, const GameInputs* inputs, Uint32 dt) {
+	batch->inputs = inputs;
+	batch->dt = dt;
+	for (int i = 1; i < batch->worker_count; i++) {
+		SDL_SemPost(batch->workers[i].start);
+	}
+	step_games(batch, &batch->workers[0]);
+	for (int i = 1; i < batch->worker_count; i++) {
+		SDL_SemWait(batch->done);
+	}
+	batch->inputs = NULL;
+}
+
+Uint64 get_game_batch_steps(const GameBatch* batch) {
+	Uint64 steps = 0;
+	for (int i = 0; i < batch->worker_count; i++) {
+		steps += batch->workers[i].steps;
+	}
+	return steps;
+}
+
+Uint64 get_game_batch_placements(const GameBatch* batch) {
+	Uint64 placements = 0;
+	for (int i = 0; i < batch->worker_count; i++) {
+		placements += batch->workers[i].placements;
+	}
+	return placements;
+}
+
+void destroy_game_batch(GameBatch* batch) {
+	if (!batch) return;
+	if (batch->workers) {
+		stop_workers(batch);
+		for (int i = 1; i < batch->worker_count; i++) {
+			SDL_DestroySemaphore(batch->workers[i].start);
+		}
+		free(batch->workers);
+	}
+	if (batch->done) {
+		SDL_DestroySemaphore(batch->done);
+	}
+	for (int i = 0; i < batch->count; i++) {
+		free_game_core(&batch->games[i]);
+	}
+	free(batch->games);
+	free(batch->events);
+	free(batch);
+}
+
+// A spread of fixed actions so games place pieces in different columns. Every game hard drops each step to keep placements flowing.
+static void fill_benchmark_inputs(GameInputs* inputs, int count) {
+	for (int i = 0; i < count; i++) {
+		inputs[i] = (GameInputs){ 0 };
+		inputs[i].move_left = i % 3 == 0;
+		inputs[i].move_right = i % 3 == 1;
+		inputs[i].rotate = i % 4 != 0;
+		inputs[i].clockwise = i % 2 == 0;
+		inputs[i].hard_drop = true;
+	}
+}
+
+void run_game_batch_benchmark(int game_count, int board_width, int board_height, Uint64 seed, PieceRandomizer randomizer, int thread_count) {
+	GameBatch* batch = create_game_batch(game_count, board_width, board_height, ENDLESS, seed, randomizer, thread_count);
+	GameInputs* inputs = malloc(sizeof(GameInputs) * MAX(1, game_count));
+	if (!batch || !inputs) {
+		fprintf(stderr, "Error: Failed to set up batch benchmark\n");
+		destroy_game_batch(batch);
+		free(inputs);
+		return;
+	}
+	fill_benchmark_inputs(inputs, game_count);
+
+	Uint64 start = SDL_GetPerformanceCounter();
+	double seconds = 0;
+	int batch_steps = 0;
+	while (seconds < BENCHMARK_SECONDS) {
+		step_game_batch(batch, inputs, BENCHMARK_STEP_TIME);
+		batch_steps++;
+		seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+	}
+
+	Uint64 steps = get_game_batch_steps(batch);
+	Uint64 placements = get_game_batch_placements(batch);
+	Uint64 games_finished = 0;
+	for (int i = 0; i < batch->worker_count; i++) {
+		games_finished += batch->workers[i].games_finished;
+	}
+	printf("%d games on %dx%d boards on %d threads, %d batch steps in %.2f s\n", batch->count, board_width, board_height, batch->worker_count, batch_steps, seconds);
+	printf("%14.0f steps/sec\n", steps / seconds);
+	printf("%14.0f placements/sec\n", placements / seconds);
+	printf("%14llu games finished\n", (unsigned long long)games_finished);
+
+	free(inputs);
+	destroy_game_batch(batch);
+}
@@ -0,0 +1,362 @@
+#include "GameCore.h"
+#include "Constants.h"
+#include "Zobrist.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// The player piece comes from here so spawning never hits the heap. Upcoming pieces are only types, so one piece plus a spare is enough.
+#define GAME_PIECE_POOL_CAPACITY 2
+
+bool init_game_core(GameCore* game, int board_width, int board_height, Uint64 seed) {
+	*game = (GameCore){ 0 };
+	game->board = create_grid(board_width, board_height, true, true);
+	game->piece_queue = create_piece_queue(PREVIEW_LENGTH, seed);
+	game->piece_pool = create_piece_pool(GAME_PIECE_POOL_CAPACITY);
+	if (!game->board || !game->piece_queue || !game->piece_pool) {
+		fprintf(stderr, "Error: Failed to create game core\n");
+		free_game_core(game);
+		return false;
+	}
+	game->current_state = GAME_STATE_MENU;
+	return true;
+}
+
+void free_game_core(GameCore* game) {
+	if (game->piece_pool) {
+		release_piece(game->piece_pool, game->player_piece);
+	}
+	destroy_piece_pool(game->piece_pool);
+	destroy_piece_queue(game->piece_queue);
+	destroy_grid(game->board);
+	*game = (GameCore){ 0 };
+}
+
+GameCore* create_game_core(int board_width, int board_height, Uint64 seed) {
+	GameCore* game = malloc(sizeof(GameCore));
+	if (!game) {
+		fprintf(stderr, "Error: Failed to allocate memory for GameCore\n");
+		return NULL;
+	}
+	if (!init_game_core(game, board_width, board_height, seed)) {
+		free(game);
+		return NULL;
+	}
+	return game;
+}
+
+void destroy_game_core(GameCore* game) {
+	if (!game) return;
+	free_game_core(game);
+	free(game);
+}
+
+static const char* get_row_clear_label(int rows) {
+	switch (rows) {
+	case 1: return "SINGLE";
+	case 2: return "DOUBLE";
+	case 3: return "TRIPLE";
+	case 4: return "QUADRUPLE";
+	default: return "";
+	}
+}
+
+static void dequeue_next_player_piece(GameCore* game) {
+	release_piece(game->piece_pool, game->player_piece);
+	game->player_piece = acquire_new_piece(game->piece_pool, next_piece_type(game->piece_queue));
+	game->player_piece->row_pos = 0;
+	game->player_piece->col_pos = game->board->width / 2 - game->player_piece->width / 2;
+}
+
+static void update_drop_speed(GameCore* game) {
+	game->drop_delay = MAX(100, BASE_DROP_DELAY * pow(0.93, (game->level - 1)));
+}
+
+static void update_level(GameCore* game) {
+	if (game->lines_cleared_this_level >= game->required_lines_level_up) {
+		game->lines_cleared_this_level -= game->required_lines_level_up; // Reset lines cleared this level and carry over the rest to next level
+		game->required_lines_level_up = BASE_LINES_PER_LEVEL * pow(1.1, game->level++); // Increase the number of lines needed for next level, then increment level
+		game->level_up_label_display_start_time = game->time;
+		update_drop_speed(game);
+	}
+}
+
+static void calculate_score(GameCore* game) {
+	game->score += game->current_lines_cleared * BASE_LINE_SCORE * game->current_lines_cleared * game->level * (game->flags.combo ? COMBO_MULTIPLIER : 1);
+}
+
+static void start_game(GameCore* game) {
+	game->last_player_drop_time = game->start_time = game->time;
+	game->current_state = GAME_STATE_PLAYING;
+	dequeue_next_player_piece(game);
+}
+
+void seed_game_core(GameCore* game, Uint64 seed, PieceRandomizer randomizer) {
+	seed_piece_queue(game->piece_queue, seed, randomizer);
+}
+
+void start_game_mode(GameCore* game, GameMode mode) {
+	game->current_mode = mode;
+	game->main_label[0] = '\0';
+	fill_piece_queue(game->piece_queue);
+	game->level = 1;
+	game->score = 0;
+	game->total_lines_cleared = 0;
+	game->lines_cleared_this_level = 0;
+	game->elapsed_time = 0;
+	game->total_row_clear_time = 0;
+	game->countdown = 3;
+	game->drop_delay = BASE_DROP_DELAY;
+	game->required_lines_level_up = BASE_LINES_PER_LEVEL;
+	game->label_display_start_time = game->time - COUNTDOWN_DISPLAY_DURATION; // Shows the first count on the next step
+	game->level_up_label_display_start_time = game->time - LEVEL_UP_LABEL_DISPLAY_DURATION; // Prevents showing the label at start of game
+	game->combo_label_display_start_time = game->time - COMBO_LABEL_DISPLAY_DURATION; // Prevents showing the label at start of game
+	game->current_state = GAME_STATE_COUNTDOWN;
+}
+
+void reset_game_core(GameCore* game) {
+	game->current_state = GAME_STATE_MENU;
+	clear_grid(game->board);
+	release_piece(game->piece_pool, game->player_piece);
+	game->player_piece = NULL;
+}
+
+// Game time stands still while paused, so nothing needs adjusting on resume
+void toggle_game_pause(GameCore* game) {
+	if (game->current_state == GAME_STATE_PLAYING) {
+		game->current_state = GAME_STATE_PAUSED;
+	}
+	else if (game->current_state == GAME_STATE_PAUSED) {
+		game->current_state = GAME_STATE_PLAYING;
+	}
+}
+
+static Uint32 game_over(GameCore* game) {
+	game->current_state = GAME_OVER_MENU;
+	game->flags.check_full_rows = false;
+	game->flags.dropping_pieces = false;
+	game->flags.move_player_down = false;
+	game->flags.move_player_left = false;
+	game->flags.move_player_right = false;
+	game->flags.shift_player_left = false;
+	game->flags.shift_player_right = false;
+	game->flags.rotate_player = false;
+	game->flags.drop_player = false;
+	snprintf(game->main_label, sizeof(game->main_label), "GAME OVER!");
+	return GAME_EVENT_GAME_OVER;
+}
+
+static bool move_player_left(GameCore* game) {
+	Piece* player_piece = game->player_piece;
+	if (validate_piece_at_position(game->board, player_piece, player_piece->row_pos, player_piece->col_pos - 1)) {
+		player_piece->col_pos--;
+		return true;
+	}
+	return false;
+}
+
+static bool move_player_right(GameCore* game) {
+	Piece* player_piece = game->player_piece;
+	if (validate_piece_at_position(game->board, player_piece, player_piece->row_pos, player_piece->col_pos + 1)) {
+		player_piece->col_pos++;
+		return true;
+	}
+	return false;
+}
+
+static bool shift_player(GameCore* game, bool left) {
+	Piece* player_piece = game->player_piece;
+	int distance = get_shift_distance(game->board, player_piece, left);
+	player_piece->col_pos += left ? -distance : distance;
+	return distance > 0;
+}
+
+static bool move_player_down(GameCore* game) {
+	Piece* player_piece = game->player_piece;
+	if (validate_piece_at_position(game->board, player_piece, player_piece->row_pos + 1, player_piece->col_pos)) {
+		player_piece->row_pos++;
+		return true;
+	}
+	return false;
+}
+
+static void take_inputs(GameCore* game, const GameInputs* inputs) {
+	GameFlags* flags = &game->flags;
+	if (inputs->rotate) {
+		flags->rotate_player = true;
+		flags->clockwise_rotation = inputs->clockwise;
+	}
+	flags->move_player_down |= inputs->move_down;
+	flags->move_player_left |= inputs->move_left;
+	flags->move_player_right |= inputs->move_right;
+	flags->shift_player_left |= inputs->shift_left;
+	flags->shift_player_right |= inputs->shift_right;
+	flags->drop_player |= inputs->hard_drop;
+}
+
+static Uint32 step_countdown(GameCore* game) {
+	Uint32 events = 0;
+	if (game->time - game->label_display_start_time >= COUNTDOWN_DISPLAY_DURATION) {
+		snprintf(game->main_label, sizeof(game->main_label), "%d", game->countdown);
+		game->label_display_start_time = game->time;
+		if (game->countdown <= 0) {
+			snprintf(game->main_label, sizeof(game->main_label), "GO!");
+			start_game(game);
+			events |= GAME_EVENT_START;
+		}
+		game->countdown--;
+	}
+	return events;
+}
+
+static Uint32 step_playing(GameCore* game) {
+	GameFlags* flags = &game->flags;
+	Grid* board = game->board;
+	Uint32 time_now = game->time;
+	Uint32 events = 0;
+	bool lock_piece = false;
+	bool drop_player = false;
+
+	update_level(game);
+	if (flags->check_full_rows) {
+		// Check for full rows
+		game->current_lines_cleared = check_and_mark_full_rows(board);
+		if (game->current_lines_cleared > 0) {
+			flags->dropping_pieces = true;
+			game->row_clear_start_time = time_now;
+			game->total_lines_cleared += game->current_lines_cleared;
+			game->lines_cleared_this_level += game->current_lines_cleared;
+			calculate_score(game);
+			snprintf(game->main_label, sizeof(game->main_label), "%s", get_row_clear_label(game->current_lines_cleared));
+			game->label_display_start_time = time_now;
+			game->combo_label_display_start_time = flags->combo ? time_now : time_now - COMBO_LABEL_DISPLAY_DURATION;
+			events |= GAME_EVENT_CLEAR;
+		}
+		flags->combo = false;
+		flags->check_full_rows = false;
+		return events;
+	}
+	if (flags->dropping_pieces) {
+		if (time_now - game->row_clear_start_time >= ROW_CLEAR_TIME) {
+			clear_full_rows(board);
+			drop_all_pieces(board);
+			game->total_row_clear_time += time_now - game->row_clear_start_time;
+			game->last_player_drop_time = time_now;
+			flags->dropping_pieces = false;
+			// Check for full rows again
+			flags->check_full_rows = true;
+			flags->combo = true;
+		}
+		return events;
+	}
+	game->elapsed_time = time_now - game->start_time - game->total_row_clear_time;
+	bool time_up = game->current_mode == BLITZ && game->elapsed_time > BLITZ_TIME;
+	bool reached_line_limit = game->current_mode == FOURTY_LINES && game->total_lines_cleared >= 40;
+	if (time_up || reached_line_limit) {
+		if (time_up) {
+			game->elapsed_time = BLITZ_TIME;
+		}
+		return game_over(game);
+	}
+	if (game->player_piece == NULL) {
+		dequeue_next_player_piece(game);
+	}
+
+	if (time_now - game->last_player_drop_time >= game->drop_delay) {
+		game->last_player_drop_time = time_now;
+		flags->move_player_down = true;
+	}
+
+	if (flags->move_player_left) {
+		if (move_player_left(game)) {
+			events |= GAME_EVENT_MOVE;
+		}
+		flags->move_player_left = false;
+	}
+	if (flags->move_player_right) {
+		if (move_player_right(game)) {
+			events |= GAME_EVENT_MOVE;
+		}
+		flags->move_player_right = false;
+	}
+	if (flags->shift_player_left) {
+		if (shift_player(game, true)) {
+			events |= GAME_EVENT_MOVE;
+		}
+		flags->shift_player_left = false;
+	}
+	if (flags->shift_player_right) {
+		if (shift_player(game, false)) {
+			events |= GAME_EVENT_MOVE;
+		}
+		flags->shift_player_right = false;
+	}
+	if (flags->rotate_player) {
+		if (try_rotate_piece(board, game->player_piece, flags->clockwise_rotation)) {
+			events |= GAME_EVENT_MOVE;
+		}
+		flags->rotate_player = false;
+	}
+	if (flags->move_player_down) {
+		lock_piece = !move_player_down(game);
+		flags->move_player_down = false;
+	}
+	if (flags->drop_player) {
+		drop_player = true;
+		lock_piece = true;
+		flags->drop_player = false;
+		game->last_player_drop_time = time_now;
+	}
+
+	// Nothing to redraw if the piece hasn't moved or rotated and the board under it is the same
+	if (lock_piece || !is_piece_drawn(board, game->player_piece)) {
+		clear_unlocked_cells(board);
+		bool piece_added = add_piece_to_grid(board, game->player_piece, lock_piece, drop_player);
+		if (!piece_added) {
+			// If the piece can't be added, it means it has reached the top of the board
+			mark_x_cells(board, game->player_piece);
+			return events | game_over(game);
+		}
+	}
+
+	if (lock_piece) {
+		release_piece(game->piece_pool, game->player_piece);
+		game->player_piece = NULL;
+		// Check for full rows on next iteration
+		flags->check_full_rows = true;
+		events |= GAME_EVENT_LOCK;
+	}
+	return events;
+}
+
+Uint64 get_game_hash(const GameCore* game) {
+	// The board hash is kept up to date as cells lock, only the piece and preview are added here
+	Uint64 hash = game->board->board_hash;
+	const Piece* piece = game->player_piece;
+	if (piece) {
+		hash ^= get_piece_key(piece->type, piece->rotation, piece->row_pos, piece->col_pos);
+	}
+	for (int i = 0; i < game->piece_queue->length; i++) {
+		hash ^= get_queue_key(i, peek_piece_type(game->piece_queue, i));
+	}
+	return hash;
+}
+
+Uint32 game_step(GameCore* game, const GameInputs* inputs, Uint32 dt) {
+	if (game->current_state == GAME_STATE_PAUSED) {
+		return 0;
+	}
+	game->time += dt;
+
+	switch (game->current_state) {
+	case GAME_STATE_COUNTDOWN:
+		return step_countdown(game);
+	case GAME_STATE_PLAYING:
+		if (inputs) {
+			take_inputs(game, inputs);
+		}
+		return step_playing(game);
+	default:
+		return 0;
+	}
+}
@@ -0,0 +1,276 @@
+#include "GameSnapshot.h"
+#include "Constants.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Fixed part of a snapshot. The arrays follow it in the order take_game_snapshot writes them.
+typedef struct {
+	GameCore core; // Its pointers are the game's own and are kept on restore
+	int width;
+	int height;
+	int queue_length;
+	int game_pool_capacity;
+	int board_pool_capacity;
+	int player_slot; // Game pool slot of the piece in play, -1 for none
+	int game_free_count;
+	int queue_front;
+	Random random;
+	PieceRandomizer randomizer;
+	enum PieceType bag[PIECE_TYPE_COUNT];
+	int bag_count;
+	int stack_top;
+	bool column_tops_dirty;
+	Uint32 lock_version;
+	Uint64 board_hash;
+	int x_top;
+	int x_bottom;
+	int active_slot; // Game pool slot the board last drew as its unlocked piece, -1 for none
+	Piece drawn_piece;
+	int drawn_shadow_row;
+	bool has_drawn_piece;
+	Uint32 drawn_lock_version;
+	// Free slots below capacity - high_water_mark have never been handed out since the pool was reset, so they still
+	// hold their reset values and only the stack above them is saved
+	int board_free_start;
+	int board_free_count;
+	int board_high_water_mark;
+	int locked_count;
+} SnapshotHeader;
+
+static void put_bytes(Uint8** cursor, const void* source, size_t size) {
+	memcpy(*cursor, source, size);
+	*cursor += size;
+}
+
+static void get_bytes(const Uint8** cursor, void* dest, size_t size) {
+	memcpy(dest, *cursor, size);
+	*cursor += size;
+}
+
+static int get_pool_slot(const PiecePool* pool, const Piece* piece) {
+	if (piece >= pool->pieces && piece < pool->pieces + pool->capacity) {
+		return (int)(piece - pool->pieces);
+	}
+	return -1;
+}
+
+static size_t get_snapshot_size(const GameCore* game) {
+	const Grid* board = game->board;
+	int cell_count = board->width * board->height;
+	int board_free = board->piece_pool->free_count - (board->piece_pool->capacity - board->piece_pool->high_water_mark);
+	int locked_count = board->locked_pieces->size;
+	return sizeof(SnapshotHeader)
+		+ sizeof(enum PieceType) * game->piece_queue->length
+		+ sizeof(Cell) * cell_count
+		+ sizeof(Uint64) * board->height * board->row_words
+		+ sizeof(int) * board->width
+		+ sizeof(bool) * board->height
+		+ (sizeof(Piece) + sizeof(int)) * game->piece_pool->capacity
+		+ sizeof(int) * board_free
+		+ (sizeof(int) + sizeof(Piece)) * locked_count;
+}
+
+bool take_game_snapshot(const GameCore* game, GameSnapshot* snapshot) {
+	size_t size = get_snapshot_size(game);
+	if (size > snapshot->capacity) {
+		Uint8* data = realloc(snapshot->data, size);
+		if (!data) {
+			fprintf(stderr, "Error: Failed to allocate %zu bytes for a game snapshot\n", size);
+			return false;
+		}
+		snapshot->data = data;
+		snapshot->capacity = size;
+	}
+	const Grid* board = game->board;
+	const PiecePool* game_pool = game->piece_pool;
+	const PiecePool* board_pool = board->piece_pool;
+	const PieceQueue* queue = game->piece_queue;
+	SnapshotHeader header = {
+		.core = *game,
+		.width = board->width,
+		.height = board->height,
+		.queue_length = queue->length,
+		.game_pool_capacity = game_pool->capacity,
+		.board_pool_capacity = board_pool->capacity,
+		.player_slot = get_pool_slot(game_pool, game->player_piece),
+		.game_free_count = game_pool->free_count,
+		.queue_front = queue->front,
+		.random = queue->random,
+		.randomizer = queue->randomizer,
+		.bag_count = queue->bag_count,
+		.stack_top = board->stack_top,
+		.column_tops_dirty = board->column_tops_dirty,
+		.lock_version = board->lock_version,
+		.board_hash = board->board_hash,
+		.x_top = board->x_top,
+		.x_bottom = board->x_bottom,
+		.active_slot = get_pool_slot(game_pool, board->active_piece),
+		.drawn_piece = board->drawn_piece,
+		.drawn_shadow_row = board->drawn_shadow_row,
+		.has_drawn_piece = board->has_drawn_piece,
+		.drawn_lock_version = board->drawn_lock_version,
+		.board_free_start = board_pool->capacity - board_pool->high_water_mark,
+		.board_free_count = board_pool->free_count,
+		.board_high_water_mark = board_pool->high_water_mark,
+		.locked_count = board->locked_pieces->size
+	};
+	memcpy(header.bag, queue->bag, sizeof(header.bag));
+
+	Uint8* cursor = snapshot->data;
+	put_bytes(&cursor, &header, sizeof(header));
+	put_bytes(&cursor, queue->types, sizeof(enum PieceType) * queue->length);
+	put_bytes(&cursor, board->cells, sizeof(Cell) * board->width * board->height);
+	put_bytes(&cursor, board->row_bits, sizeof(Uint64) * board->height * board->row_words);
+	put_bytes(&cursor, board->column_tops, sizeof(int) * board->width);
+	put_bytes(&cursor, board->full_rows, sizeof(bool) * board->height);
+	put_bytes(&cursor, game_pool->pieces, sizeof(Piece) * game_pool->capacity);
+	put_bytes(&cursor, game_pool->free_indices, sizeof(int) * game_pool->capacity);
+	put_bytes(&cursor, board_pool->free_indices + header.board_free_start, sizeof(int) * (header.board_free_count - header.board_free_start));
+	for (int i = 0; i < header.locked_count; i++) {
+		int slot = get_pool_slot(board_pool, board->locked_pieces->items[i]);
+		put_bytes(&cursor, &slot, sizeof(int));
+	}
+	for (int i = 0; i < header.locked_count; i++) {
+		put_bytes(&cursor, board->locked_pieces->items[i], sizeof(Piece));
+	}
+	snapshot->size = size;
+	return true;
+}
+
+bool restore_game_snapshot(GameCore* game, const GameSnapshot* snapshot) {
+	if (snapshot->size < sizeof(SnapshotHeader)) {
+		fprintf(stderr, "Error: Snapshot is empty\n");
+		return false;
+	}
+	SnapshotHeader header;
+	const Uint8* cursor = snapshot->data;
+	get_bytes(&cursor, &header, sizeof(header));
+	Grid* board = game->board;
+	PiecePool* game_pool = game->piece_pool;
+	PiecePool* board_pool = board->piece_pool;
+	PieceQueue* queue = game->piece_queue;
+	if (header.width != board->width || header.height != board->height || header.queue_length != queue->length
+		|| header.game_pool_capacity != game_pool->capacity || header.board_pool_capacity != board_pool->capacity) {
+		fprintf(stderr, "Error: Snapshot of a %dx%d game can't be restored into a %dx%d one\n", header.width, header.height, board->width, board->height);
+		return false;
+	}
+
+	GameCore core = header.core;
+	core.board = board;
+	core.piece_pool = game_pool;
+	core.piece_queue = queue;
+	core.player_piece = header.player_slot >= 0 ? &game_pool->pieces[header.player_slot] : NULL;
+	*game = core;
+
+	queue->front = header.queue_front;
+	queue->random = header.random;
+	queue->randomizer = header.randomizer;
+	memcpy(queue->bag, header.bag, sizeof(header.bag));
+	queue->bag_count = header.bag_count;
+	get_bytes(&cursor, queue->types, sizeof(enum PieceType) * queue->length);
+
+	board->stack_top = header.stack_top;
+	board->column_tops_dirty = header.column_tops_dirty;
+	board->lock_version = header.lock_version;
+	board->board_hash = header.board_hash;
+	board->x_top = header.x_top;
+	board->x_bottom = header.x_bottom;
+	board->active_piece = header.active_slot >= 0 ? &game_pool->pieces[header.active_slot] : NULL;
+	board->drawn_piece = header.drawn_piece;
+	board->drawn_shadow_row = header.drawn_shadow_row;
+	board->has_drawn_piece = header.has_drawn_piece;
+	board->drawn_lock_version = header.drawn_lock_version;
+	get_bytes(&cursor, board->cells, sizeof(Cell) * board->width * board->height);
+	get_bytes(&cursor, board->row_bits, sizeof(Uint64) * board->height * board->row_words);
+	get_bytes(&cursor, board->column_tops, sizeof(int) * board->width);
+	get_bytes(&cursor, board->full_rows, sizeof(bool) * board->height);
+
+	get_bytes(&cursor, game_pool->pieces, sizeof(Piece) * game_pool->capacity);
+	get_bytes(&cursor, game_pool->free_indices, sizeof(int) * game_pool->capacity);
+	game_pool->free_count = header.game_free_count;
+
+	// Slots this pool has handed out since the snapshot's high water mark go back to their reset values too
+	int reset_start = MIN(board_pool->capacity - board_pool->high_water_mark, header.board_free_start);
+	for (int i = reset_start; i < header.board_free_start; i++) {
+		board_pool->free_indices[i] = board_pool->capacity - 1 - i;
+	}
+	get_bytes(&cursor, board_pool->free_indices + header.board_free_start, sizeof(int) * (header.board_free_count - header.board_free_start));
+	board_pool->free_count = header.board_free_count;
+	board_pool->high_water_mark = MAX(board_pool->high_water_mark, header.board_high_water_mark);
+
+	// Pieces are written into the slots they were in, since cells refer to them by slot
+	const Uint8* slots = cursor;
+	const Uint8* pieces = cursor + sizeof(int) * header.locked_count;
+	empty_dynamic_array(board->locked_pieces);
+	for (int i = 0; i < header.locked_count; i++) {
+		int slot;
+		memcpy(&slot, slots + sizeof(int) * i, sizeof(int));
+		Piece* piece = &board_pool->pieces[slot];
+		memcpy(piece, pieces + sizeof(Piece) * i, sizeof(Piece));
+		if (!add_to_dynamic_array(board->locked_pieces, piece)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void free_game_snapshot(GameSnapshot* snapshot) {
+	free(snapshot->data);
+	*snapshot = (GameSnapshot){ 0 };
+}
+
+SnapshotRing* create_snapshot_ring(int capacity) {
+	if (capacity <= 0) {
+		fprintf(stderr, "Error: Snapshot ring capacity must be greater than 0\n");
+		return NULL;
+	}
+	SnapshotRing* ring = malloc(sizeof(SnapshotRing));
+	if (!ring) {
+		fprintf(stderr, "Error: Failed to allocate memory for SnapshotRing\n");
+		return NULL;
+	}
+	ring->snapshots = calloc(capacity, sizeof(GameSnapshot));
+	ring->frames = calloc(capacity, sizeof(Uint64));
+	ring->saved = calloc(capacity, sizeof(bool));
+	ring->capacity = capacity;
+	if (!ring->snapshots || !ring->frames || !ring->saved) {
+		fprintf(stderr, "Error: Failed to allocate memory for %d snapshots\n", capacity);
+		destroy_snapshot_ring(ring);
+		return NULL;
+	}
+	return ring;
+}
+
+bool save_snapshot_frame(SnapshotRing* ring, const GameCore* game, Uint64 frame) {
+	int slot = (int)(frame % ring->capacity);
+	ring->saved[slot] = take_game_snapshot(game, &ring->snapshots[slot]);
+	ring->frames[slot] = frame;
+	return ring->saved[slot];
+}
+
+bool rollback_to_frame(SnapshotRing* ring, GameCore* game, Uint64 frame) {
+	int slot = (int)(frame % ring->capacity);
+	if (!ring->saved[slot] || ring->frames[slot] != frame || !restore_game_snapshot(game, &ring->snapshots[slot])) {
+		return false;
+	}
+	for (int i = 0; i < ring->capacity; i++) {
+		if (ring->frames[i] > frame) {
+			ring->saved[i] = false;
+		}
+	}
+	return true;
+}
+
+void destroy_snapshot_ring(SnapshotRing* ring) {
+	if (!ring) return;
+	if (ring->snapshots) {
+		for (int i = 0; i < ring->capacity; i++) {
+			free_game_snapshot(&ring->snapshots[i]);
+		}
+	}
+	free(ring->snapshots);
+	free(ring->frames);
+	free(ring->saved);
+	free(ring);
+}
@@ -1,18 +1,25 @@
 #include "Grid.h"
 #include "Piece.h"
 #include "Constants.h"
-#include "AlphaFade.h"
+#include "BitUtils.h"
+#include "Zobrist.h"
 #include <stdio.h>
+#include <string.h>
 
 static bool allocate_cells(Grid* grid);
-static void deallocate_cells(Cell** cells, int height);
-static void init_cells_in_row(Cell* cells, int width);
-static bool validate_grid_position(Grid* grid, int row, int col);
+static Uint64* get_row_bits(Grid* grid, int row);
+static bool is_row_full(Grid* grid, int row);
+static bool is_row_empty(Grid* grid, int row);
+static Uint32 piece_ref(Grid* grid, const Piece* piece);
+static bool piece_collides(Grid* grid, Piece* piece, int row, int col);
+static int find_drop_row(Grid* grid, Piece* piece, int row, int col);
+static void reset_column_tops(Grid* grid);
+static void rebuild_column_tops(Grid* grid);
+static void set_cell_lock(Grid* grid, int row, int col, bool lock);
 static bool insert_piece(Grid* grid, Piece* piece, bool lock);
 static bool drop_piece_on_grid(Grid* grid, Piece* piece, bool lock);
 static void mark_shadow_predictions(Grid* grid, Piece* piece);
 static void remove_empty_pieces(Grid* grid);
-static void clear_x_cells(Grid* grid);
 
 // Possible position shifts (row, col) to check after rotation
 static const int wall_kick_attempts[10][2] = {
@@ -28,28 +35,25 @@ static const int wall_kick_attempts[10][2] = {
 	{ +2,  0 }  // Long piece needs more room
 };
 
-static bool is_near_height_limit(Grid* grid) {
-	SDL_assert(grid->height > 4);
-	// Check if there is a locked piece in the top 4 rows
-	for (int row = 0; row < 4; row++) {
-		for (int col = 0; col < grid->width; col++) {
-			if (grid->cells[row][col].locked && grid->cells[row][col].piece) {
-				return true;
-			}
-		}
-	}
-	return false;
-}
-
 Grid* create_grid(int width, int height, bool show_lines, bool is_game_board) {
+	if (width <= 0 || width > MAX_GRID_WIDTH || height <= 0) {
+		fprintf(stderr, "Error: Invalid Grid dimensions %dx%d\n", width, height);
+		return NULL;
+	}
 	Grid* grid = malloc(sizeof(Grid));
 	if (!grid) {
 		fprintf(stderr, "Error: Failed to allocate memory for Grid\n");
 		return NULL;
 	}
-	grid->locked_pieces = create_dynamic_array(10, destroy_piece);
-	if (!grid->locked_pieces) {
-		fprintf(stderr, "Error: Failed to create dynamic array for locked pieces\n");
+	// Every locked piece covers at least one cell, and a row clear can at most add one split fragment per cleared cell.
+	// Twice the cell count (plus headroom for a split in progress) is therefore enough for any board.
+	int pool_capacity = width * height * 2 + 2;
+	grid->piece_pool = create_piece_pool(pool_capacity);
+	grid->locked_pieces = create_indexed_dynamic_array(pool_capacity, NULL, true); // Order doesn't matter, so removal can swap
+	if (!grid->piece_pool || !grid->locked_pieces) {
+		fprintf(stderr, "Error: Failed to create storage for locked pieces\n");
+		destroy_piece_pool(grid->piece_pool);
+		destroy_dynamic_array(grid->locked_pieces);
 		free(grid);
 		return NULL;
 	}
@@ -60,11 +64,41 @@ Grid* create_grid(int width, int height, bool show_lines, bool is_game_board) {
 	grid->full_rows = calloc(height, sizeof(bool));
 	if (!grid->full_rows) {
 		fprintf(stderr, "Error: Failed to allocate memory for full rows\n");
+		destroy_piece_pool(grid->piece_pool);
+		destroy_dynamic_array(grid->locked_pieces);
+		free(grid);
+		return NULL;
+	}
+	grid->active_piece = NULL;
+	grid->lock_version = 0;
+	grid->board_hash = 0;
+	grid->has_drawn_piece = false;
+	grid->row_words = GRID_ROW_WORDS(width);
+	grid->last_word_mask = width % 64 == 0 ? ~(Uint64)0 : ((Uint64)1 << (width % 64)) - 1;
+	grid->row_bits = calloc(height * grid->row_words, sizeof(Uint64));
+	grid->x_top = height;
+	grid->x_bottom = -1;
+	grid->column_tops = malloc(sizeof(int) * width);
+	grid->gravity_queue = malloc(sizeof(int) * pool_capacity);
+	grid->gravity_shift = malloc(sizeof(int) * pool_capacity);
+	grid->gravity_queued = calloc(pool_capacity, sizeof(bool));
+	grid->split_pieces = malloc(sizeof(Piece*) * width);
+	if (!grid->row_bits || !grid->column_tops || !grid->gravity_queue || !grid->gravity_shift || !grid->gravity_queued || !grid->split_pieces) {
+		fprintf(stderr, "Error: Failed to allocate memory for occupancy tracking\n");
+		free(grid->row_bits);
+		free(grid->column_tops);
+		free(grid->gravity_queue);
+		free(grid->gravity_shift);
+		free(grid->gravity_queued);
+		free(grid->split_pieces);
+		free(grid->full_rows);
+		destroy_piece_pool(grid->piece_pool);
 		destroy_dynamic_array(grid->locked_pieces);
 		free(grid);
 		return NULL;
 	}
-	grid->fade_start_time = 0;
+
+	reset_column_tops(grid);
 
 	if (!allocate_cells(grid)) {
 		return NULL;
@@ -75,30 +109,238 @@ Grid* create_grid(int width, int height, bool show_lines, bool is_game_board) {
 
 void destroy_grid(Grid* grid) {
 	if (grid) {
-		deallocate_cells(grid->cells, grid->height);
+		free(grid->cells);
 		destroy_dynamic_array(grid->locked_pieces);
+		destroy_piece_pool(grid->piece_pool);
 		free(grid->full_rows);
+		free(grid->row_bits);
+		free(grid->column_tops);
+		free(grid->gravity_queue);
+		free(grid->gravity_shift);
+		free(grid->gravity_queued);
+		free(grid->split_pieces);
 		free(grid);
 	}
 }
 
-bool validate_piece_at_position(Grid* grid, Piece* piece, int row, int col) {
+Cell* get_grid_cell(Grid* grid, int row, int col) {
+	return &grid->cells[row * grid->width + col];
+}
+
+static Uint64* get_row_bits(Grid* grid, int row) {
+	return &grid->row_bits[row * grid->row_words];
+}
+
+static bool is_row_full(Grid* grid, int row) {
+	Uint64* bits = get_row_bits(grid, row);
+	for (int w = 0; w < grid->row_words - 1; w++) {
+		if (bits[w] != ~(Uint64)0) {
+			return false;
+		}
+	}
+	return bits[grid->row_words - 1] == grid->last_word_mask;
+}
+
+static bool is_row_empty(Grid* grid, int row) {
+	Uint64* bits = get_row_bits(grid, row);
+	for (int w = 0; w < grid->row_words; w++) {
+		if (bits[w]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Cells refer to pieces by pool slot so the cell buffer stays small and can be copied as a block
+static Uint32 piece_ref(Grid* grid, const Piece* piece) {
+	PiecePool* pool = grid->piece_pool;
+	if (piece >= pool->pieces && piece < pool->pieces + pool->capacity) {
+		return (Uint32)(piece - pool->pieces) + CELL_POOL_OFFSET;
+	}
+	SDL_assert(piece == grid->active_piece);
+	return CELL_ACTIVE_PIECE;
+}
+
+Piece* get_cell_piece(Grid* grid, int row, int col) {
+	Uint32 ref = get_grid_cell(grid, row, col)->piece_ref;
+	if (ref == CELL_NO_PIECE) {
+		return NULL;
+	}
+	if (ref == CELL_ACTIVE_PIECE) {
+		return grid->active_piece;
+	}
+	return &grid->piece_pool->pieces[ref - CELL_POOL_OFFSET];
+}
+
+// Tests every row of the piece against the grid with a shift and an AND instead of visiting each cell.
+// A piece row can straddle two words of a wide row, so the bits shifted past the first word are tested against the next one.
+// Empty piece rows are skipped so fragments left over from row clears can hang past the edges like before.
+static bool piece_collides(Grid* grid, Piece* piece, int row, int col) {
 	for (int i = 0; i < piece->height; i++) {
-		for (int j = 0; j < piece->width; j++) {
-			if (piece->shape[i * piece->width + j]) {
-				if (!validate_grid_position(grid, row + i, col + j)) {
-					return false;
-				}
+		Uint64 mask = piece->row_masks[i];
+		if (!mask) {
+			continue;
+		}
+		int grid_row = row + i;
+		if (grid_row < 0 || grid_row >= grid->height) {
+			return true;
+		}
+		int first_col = col;
+		if (col < 0) {
+			if (col <= -MAX_PIECE_SIZE || mask & (((Uint64)1 << -col) - 1)) {
+				return true; // Part of the row is left of the grid
+			}
+			mask >>= -col;
+			first_col = 0;
+		}
+		if (first_col >= grid->width || (first_col + MAX_PIECE_SIZE > grid->width && mask >> (grid->width - first_col))) {
+			return true; // Part of the row is right of the grid
+		}
+		Uint64* bits = get_row_bits(grid, grid_row) + first_col / 64;
+		int shift = first_col % 64;
+		if ((mask << shift) & bits[0]) {
+			return true;
+		}
+		Uint64 spill = shift ? mask >> (64 - shift) : 0;
+		if (spill && (spill & bits[1])) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void reset_column_tops(Grid* grid) {
+	for (int col = 0; col < grid->width; col++) {
+		grid->column_tops[col] = grid->height;
+	}
+	grid->stack_top = grid->height;
+	grid->column_tops_dirty = false;
+}
+
+// Walks down from the top of the grid until every column has been seen. Only needed after cells are unlocked.
+static void rebuild_column_tops(Grid* grid) {
+	reset_column_tops(grid);
+	Uint64 seen[GRID_ROW_WORDS(MAX_GRID_WIDTH)] = { 0 };
+	int unseen_columns = grid->width;
+	for (int row = 0; row < grid->height && unseen_columns > 0; row++) {
+		Uint64* bits = get_row_bits(grid, row);
+		for (int w = 0; w < grid->row_words; w++) {
+			Uint64 new_bits = bits[w] & ~seen[w];
+			if (!new_bits) {
+				continue;
+			}
+			if (grid->stack_top == grid->height) {
+				grid->stack_top = row;
+			}
+			seen[w] |= new_bits;
+			while (new_bits) {
+				grid->column_tops[w * 64 + count_trailing_zeros(new_bits)] = row;
+				new_bits &= new_bits - 1;
+				unseen_columns--;
 			}
 		}
 	}
-	return true;
+}
+
+int get_stack_top(Grid* grid) {
+	if (grid->column_tops_dirty) {
+		rebuild_column_tops(grid);
+	}
+	return grid->stack_top;
+}
+
+bool is_near_height_limit(Grid* grid) {
+	SDL_assert(grid->height > 4);
+	// Check if there is a locked piece in the top 4 rows
+	return get_stack_top(grid) < 4;
+}
+
+// Returns the lowest row the piece can reach by falling straight down from row. Assumes row itself is valid.
+static int find_drop_row(Grid* grid, Piece* piece, int row, int col) {
+	if (grid->column_tops_dirty) {
+		rebuild_column_tops(grid);
+	}
+	// If every column of the piece is above the stack, the landing row comes straight from the column tops
+	int landing_row = grid->height;
+	for (int j = 0; j < piece->width; j++) {
+		int bottom = piece->height - 1;
+		while (bottom >= 0 && !((piece->row_masks[bottom] >> j) & 1)) {
+			bottom--;
+		}
+		if (bottom < 0) {
+			continue; // Empty column in a fragment
+		}
+		int top = grid->column_tops[col + j];
+		if (row + bottom >= top) {
+			landing_row = -1; // Tucked under an overhang, the column tops say nothing about what is below
+			break;
+		}
+		landing_row = MIN(landing_row, top - 1 - bottom);
+	}
+	if (landing_row >= 0 && landing_row < grid->height) {
+		return landing_row;
+	}
+
+	while (!piece_collides(grid, piece, row + 1, col)) {
+		row++;
+	}
+	return row;
+}
+
+bool validate_piece_at_position(Grid* grid, Piece* piece, int row, int col) {
+	return !piece_collides(grid, piece, row, col);
 }
 
 bool validate_piece_position(Grid* grid, Piece* piece) {
 	return validate_piece_at_position(grid, piece, piece->row_pos, piece->col_pos);
 }
 
+// Nearest locked column left of col in row, -1 for the wall
+static int find_locked_left(Grid* grid, int row, int col) {
+	Uint64* bits = get_row_bits(grid, row);
+	int word = col / 64;
+	Uint64 below = bits[word] & (((Uint64)1 << (col % 64)) - 1);
+	while (!below) {
+		if (--word < 0) {
+			return -1;
+		}
+		below = bits[word];
+	}
+	return word * 64 + find_highest_bit(below);
+}
+
+// Nearest locked column right of col in row, width for the wall
+static int find_locked_right(Grid* grid, int row, int col) {
+	if (++col >= grid->width) {
+		return grid->width;
+	}
+	Uint64* bits = get_row_bits(grid, row);
+	int word = col / 64;
+	Uint64 above = bits[word] & (~(Uint64)0 << (col % 64));
+	while (!above) {
+		if (++word >= grid->row_words) {
+			return grid->width;
+		}
+		above = bits[word];
+	}
+	return word * 64 + count_trailing_zeros(above);
+}
+
+int get_shift_distance(Grid* grid, const Piece* piece, bool left) {
+	int distance = grid->width;
+	for (int i = 0; i < piece->height; i++) {
+		int row = piece->row_pos + i;
+		Uint8 mask = piece->row_masks[i];
+		while (mask) {
+			int col = piece->col_pos + count_trailing_zeros(mask);
+			int room = left ? col - find_locked_left(grid, row, col) - 1 : find_locked_right(grid, row, col) - col - 1;
+			distance = MIN(distance, room);
+			mask &= mask - 1;
+		}
+	}
+	return distance;
+}
+
 
 bool add_piece_to_grid(Grid* grid, Piece* piece, bool lock, bool drop) {
 	if (drop) {
@@ -118,201 +360,140 @@ bool add_piece_to_grid(Grid* grid, Piece* piece, bool lock, bool drop) {
 }
 
 static void mark_shadow_predictions(Grid* grid, Piece* piece) {
-	int row = piece->row_pos;
 	int col = piece->col_pos;
-	for (int i = 1; i <= grid->height - row; i++) {
-		if (!validate_piece_at_position(grid, piece, row + i, col)) {
-			for (int j = 0; j < piece->height; j++) {
-				for (int k = 0; k < piece->width; k++) {
-					bool shape_cell = piece->shape[j * piece->width + k];
-					Piece* grid_piece = grid->cells[row + i - 1 + j][col + k].piece;
-					// Draw a shadow where the piece will fall. Don't draw shadow on the piece itself if partially covered.
-					if (shape_cell && grid_piece != piece) {
-						grid->cells[row + i - 1 + j][col + k].shadow = true;
-					}
-				}
+	int row = find_drop_row(grid, piece, piece->row_pos, col);
+	for (int j = 0; j < piece->height; j++) {
+		for (int k = 0; k < piece->width; k++) {
+			bool shape_cell = piece->shape[j * piece->width + k];
+			// Draw a shadow where the piece will fall. Don't draw shadow on the piece itself if partially covered.
+			if (shape_cell && get_grid_cell(grid, row + j, col + k)->piece_ref != CELL_ACTIVE_PIECE) {
+				get_grid_cell(grid, row + j, col + k)->shadow = true;
 			}
-			break;
 		}
 	}
+	grid->drawn_shadow_row = row;
 }
 
 static bool drop_piece_on_grid(Grid* grid, Piece* piece, bool lock) {
-	int row = piece->row_pos;
-	int col = piece->col_pos;
-	if (!validate_piece_at_position(grid, piece, row, col)) {
+	if (!validate_piece_position(grid, piece)) {
 		return false; // Don't even bother attempting to drop if its current position is invalid. Can cause problems.
 	}
-	for (int i = 0; i <= grid->height - row; i++) {
-		if (!validate_piece_at_position(grid, piece, row + i, col)) {
-			piece->row_pos = row + i - 1;
-			return insert_piece(grid, piece, lock);
-		}
-	}
-	return false;
+	piece->row_pos = find_drop_row(grid, piece, piece->row_pos, piece->col_pos);
+	return insert_piece(grid, piece, lock);
 }
 
-// Also returns new row and column position for center rotation
-Piece* try_rotate_piece(Grid* grid, Piece* piece, bool clockwise) {
-	Piece* rotated_piece = rotate_piece(piece, clockwise);
-	if (!rotated_piece) {
-		return NULL;
-	}
-
+// Centers rotated on piece's center and tries each wall kick on it, writing the first that fits to *row and *col.
+// Neither piece is changed.
+bool find_rotation_position(Grid* grid, const Piece* piece, Piece* rotated, int* row, int* col) {
 	int center_row = piece->row_pos + piece->height / 2;
 	int center_col = piece->col_pos + piece->width / 2;
 
-	int new_row = center_row - rotated_piece->height / 2;
-	int new_col = center_col - rotated_piece->width / 2;
+	int new_row = center_row - rotated->height / 2;
+	int new_col = center_col - rotated->width / 2;
 
 	// Try all possible wall kick positions
 	for (int i = 0; i < 10; i++) {
 		int attempt_row = new_row + wall_kick_attempts[i][0];
 		int attempt_col = new_col + wall_kick_attempts[i][1];
 
-		if (validate_piece_at_position(grid, rotated_piece, attempt_row, attempt_col)) {
-			rotated_piece->row_pos = attempt_row;
-			rotated_piece->col_pos = attempt_col;
-			return rotated_piece;
+		if (validate_piece_at_position(grid, rotated, attempt_row, attempt_col)) {
+			*row = attempt_row;
+			*col = attempt_col;
+			return true;
 		}
 	}
-
-	// If all attempts fail, discard rotation
-	destroy_piece(rotated_piece);
-	return NULL;
+	return false;
 }
 
-void clear_unlocked_cells(Grid* grid) {
-	for (int i = 0; i < grid->height; i++)
-	{
-		for (int j = 0; j < grid->width; j++)
-		{
-			if (!grid->cells[i][j].locked)
-			{
-				grid->cells[i][j].piece = NULL;
-				grid->cells[i][j].shadow = false;
-			}
-		}
+bool try_rotate_piece(Grid* grid, Piece* piece, bool clockwise) {
+	Piece rotated = *piece;
+	rotate_piece(&rotated, clockwise);
+
+	int row, col;
+	if (!find_rotation_position(grid, piece, &rotated, &row, &col)) {
+		return false; // If all attempts fail, discard rotation
 	}
+	*piece = rotated;
+	piece->row_pos = row;
+	piece->col_pos = col;
+	return true;
 }
 
-void clear_grid(Grid* grid) {
-	for (int i = 0; i < grid->height; i++)
-	{
-		for (int j = 0; j < grid->width; j++)
-		{
-			grid->cells[i][j].piece = NULL;
-			grid->cells[i][j].shadow = false;
-			grid->cells[i][j].locked = false;
-		}
-	}
-	clear_x_cells(grid);
-	clear_dynamic_array(grid->locked_pieces);
+// True if the piece is already on the grid exactly as it would be drawn now, so drawing it again can be skipped
+bool is_piece_drawn(Grid* grid, const Piece* piece) {
+	const Piece* drawn = &grid->drawn_piece;
+	return grid->has_drawn_piece && grid->active_piece == piece && grid->drawn_lock_version == grid->lock_version &&
+		drawn->type == piece->type && drawn->rotation == piece->rotation &&
+		drawn->row_pos == piece->row_pos && drawn->col_pos == piece->col_pos;
 }
 
-void draw_grid(Grid* grid, int origin_x, int origin_y, int cell_width, int border_width, SDL_Renderer* renderer) {
-
-	if (border_width) {
-		SDL_SetRenderDrawColor(renderer, 128, 128, 128, SDL_ALPHA_OPAQUE);
-		// Draw a border around the grid, use the outline code below
-		SDL_Rect top_border = { origin_x, origin_y, grid->width * cell_width + border_width * 2, border_width };
-		SDL_Rect bottom_border = { origin_x, origin_y + grid->height * cell_width + border_width, grid->width * cell_width + border_width * 2, border_width };
-		SDL_Rect left_border = { origin_x, origin_y + border_width, border_width, grid->height * cell_width };
-		SDL_Rect right_border = { origin_x + grid->width * cell_width + border_width, origin_y + border_width, border_width, grid->height * cell_width };
-		SDL_RenderFillRect(renderer, &top_border);
-		SDL_RenderFillRect(renderer, &bottom_border);
-		SDL_RenderFillRect(renderer, &left_border);
-		SDL_RenderFillRect(renderer, &right_border);
-	}
-
-	bool height_warning = grid->is_game_board && is_near_height_limit(grid);
-
-	for (int i = 0; i < grid->height; i++) {
-		for (int j = 0; j < grid->width; j++) {
-			SDL_Rect cell_rect = {
-				j * cell_width + origin_x + border_width,
-				i * cell_width + origin_y + border_width,
-				cell_width,
-				cell_width
-			};
-			if (i < 2 && height_warning) {
-				SDL_SetRenderDrawColor(renderer, 255, 0, 0, 128);
-				SDL_RenderFillRect(renderer, &cell_rect);
-			}
-			if (grid->show_grid_lines) {
-				SDL_SetRenderDrawColor(renderer, 128, 128, 128, SDL_ALPHA_OPAQUE);
-				SDL_RenderDrawRect(renderer, &cell_rect);
-			}
-			Piece* piece = grid->cells[i][j].piece;
-			if (piece) {
-				Uint8 alpha = grid->full_rows[i] ? get_fade_alpha(grid->fade_start_time, ROW_CLEAR_TIME) : piece->color.a;
-				SDL_SetRenderDrawColor(renderer, piece->color.r, piece->color.g, piece->color.b, alpha);
-				SDL_RenderFillRect(renderer, &cell_rect);
-				
-				alpha >>= 1; // Shift bits once to the right to get half the value. Fast division using the power of C!
-
-				// Draw shadow / outline around block to make it look 3D from far
-				SDL_SetRenderDrawColor(renderer, 255, 255, 255, alpha);
-				SDL_Rect top_outline = { cell_rect.x, cell_rect.y, cell_width, cell_width / 8 };
-				SDL_Rect right_outline = { cell_rect.x + cell_width - cell_width / 8, cell_rect.y + cell_width / 8, cell_width / 8, cell_width - cell_width / 4 };
-				SDL_RenderFillRect(renderer, &top_outline);
-				SDL_RenderFillRect(renderer, &right_outline);
-
-				SDL_SetRenderDrawColor(renderer, 0, 0, 0, alpha);
-				SDL_Rect bottom_outline = { cell_rect.x, cell_rect.y + cell_width - cell_width / 8, cell_width, cell_width / 8 };
-				SDL_Rect left_outline = { cell_rect.x, cell_rect.y + cell_width / 8, cell_width / 8, cell_width - cell_width / 4 };
-				SDL_RenderFillRect(renderer, &bottom_outline);
-				SDL_RenderFillRect(renderer, &left_outline);
-			}
-			
-			if (grid->cells[i][j].shadow) {
-				SDL_SetRenderDrawColor(renderer, 128, 128, 128, 128);
-				SDL_RenderFillRect(renderer, &cell_rect);
+// Undoes the cells written by the last unlocked piece and its shadow instead of sweeping the whole board
+void clear_unlocked_cells(Grid* grid) {
+	if (!grid->has_drawn_piece) {
+		return;
+	}
+	Piece* piece = &grid->drawn_piece;
+	for (int i = 0; i < piece->height; i++) {
+		for (int j = 0; j < piece->width; j++) {
+			if (!piece->shape[i * piece->width + j]) {
+				continue;
 			}
-			// For debugging, normally this would be an illegal state. Helpful to visualize if row clearing messes up.
-			if (grid->cells[i][j].locked && !grid->cells[i][j].piece) {
-				SDL_SetRenderDrawColor(renderer, 255, 255, 255, 128);
-				SDL_RenderFillRect(renderer, &cell_rect);
+			Cell* cell = get_grid_cell(grid, piece->row_pos + i, piece->col_pos + j);
+			if (!cell->locked) {
+				cell->piece_ref = CELL_NO_PIECE;
 			}
-
-			if (grid->cells[i][j].x) {
-				SDL_SetRenderDrawColor(renderer, 210, 0, 0, 255);
-				// Top left to bottom right
-				// To draw a thicker line, draw multiple lines with a 1 pixel offset
-                for (int k = -3; k < 4; k++) {
-					int x = MAX(cell_rect.x, cell_rect.x + k) + 1;
-					int y = MAX(cell_rect.y, cell_rect.y - k) + 1;
-					int x2 = MIN(cell_rect.x + cell_width, cell_rect.x + cell_width + k) - 2;
-					int y2 = MIN(cell_rect.y + cell_width, cell_rect.y + cell_width - k) - 2;
-					SDL_RenderDrawLine(renderer, x, y, x2, y2);
-				}
-
-				// Bottom left to top right
-				for (int k = -3; k < 4; k++) {
-					int x = MAX(cell_rect.x, cell_rect.x + k) + 1;
-					int y = MIN(cell_rect.y + cell_width, cell_rect.y + cell_width + k) - 2;
-					int x2 = MIN(cell_rect.x + cell_width, cell_rect.x + cell_width + k) - 2;
-					int y2 = MAX(cell_rect.y, cell_rect.y + k) + 1;
-					SDL_RenderDrawLine(renderer, x, y, x2, y2);
-				}
+			if (grid->drawn_shadow_row >= 0) {
+				get_grid_cell(grid, grid->drawn_shadow_row + i, piece->col_pos + j)->shadow = false;
 			}
 		}
 	}
+	grid->has_drawn_piece = false;
 }
 
-static void clear_x_cells(Grid* grid) {
-	for (int i = 0; i < grid->height; i++) {
-		for (int j = 0; j < grid->width; j++) {
-			grid->cells[i][j].x = false;
+static void set_cell_lock(Grid* grid, int row, int col, bool lock) {
+	Cell* cell = get_grid_cell(grid, row, col);
+	if (cell->locked != lock) {
+		grid->board_hash ^= get_cell_key(row, col);
+	}
+	cell->locked = lock;
+	grid->lock_version++;
+	if (lock) {
+		get_row_bits(grid, row)[col / 64] |= (Uint64)1 << (col % 64);
+		if (row < grid->column_tops[col]) {
+			grid->column_tops[col] = row;
+		}
+		if (row < grid->stack_top) {
+			grid->stack_top = row;
+		}
+	}
+	else {
+		get_row_bits(grid, row)[col / 64] &= ~((Uint64)1 << (col % 64));
+		if (row == grid->column_tops[col]) {
+			grid->column_tops_dirty = true;
 		}
 	}
 }
 
+void clear_grid(Grid* grid) {
+	memset(grid->cells, 0, sizeof(Cell) * grid->width * grid->height); // Also clears the x marks
+	memset(grid->row_bits, 0, sizeof(Uint64) * grid->height * grid->row_words);
+	reset_column_tops(grid);
+	grid->x_top = grid->height;
+	grid->x_bottom = -1;
+	grid->lock_version++;
+	grid->board_hash = 0;
+	grid->has_drawn_piece = false;
+	clear_dynamic_array(grid->locked_pieces);
+	reset_piece_pool(grid->piece_pool);
+}
+
 void mark_x_cells(Grid* grid, Piece* piece) {
+	grid->x_top = MIN(grid->x_top, piece->row_pos);
+	grid->x_bottom = MAX(grid->x_bottom, piece->row_pos + piece->height - 1);
 	for (int i = 0; i < piece->height; i++) {
 		for (int j = 0; j < piece->width; j++) {
 			if (piece->shape[i * piece->width + j]) {
-				grid->cells[piece->row_pos + i][piece->col_pos + j].x = true;
+				get_grid_cell(grid, piece->row_pos + i, piece->col_pos + j)->x = true;
 			}
 		}
 	}
@@ -328,16 +509,33 @@ static bool insert_piece(Grid* grid, Piece* piece, bool lock) {
 
 	Piece* piece_copy = piece; // Default to original unless locking
 	if (lock && !dynamic_array_contains(grid->locked_pieces, piece)) {
-		piece_copy = copy_piece(piece); // Locked implies the Grid is now meant to own the piece. Copy it so Game can destroy its copy later.
-		add_to_dynamic_array(grid->locked_pieces, piece_copy);
+		piece_copy = acquire_piece_copy(grid->piece_pool, piece); // Locked implies the Grid is now meant to own the piece. Copy it so Game can destroy its copy later.
+		if (!piece_copy) {
+			return false;
+		}
+		if (!add_to_dynamic_array(grid->locked_pieces, piece_copy)) {
+			release_piece(grid->piece_pool, piece_copy);
+			return false;
+		}
 	}
 
+	if (!lock) {
+		grid->active_piece = piece;
+		grid->drawn_piece = *piece;
+		grid->drawn_shadow_row = -1;
+		grid->has_drawn_piece = true;
+		grid->drawn_lock_version = grid->lock_version;
+	}
+	Uint32 ref = piece_ref(grid, piece_copy);
+
 	// Draw every cell of the piece to it's corresponding cell in the grid
 	for (int i = 0; i < piece->height; i++) {
 		for (int j = 0; j < piece->width; j++) {
 			if (piece->shape[i * piece->width + j]) {
-				grid->cells[row + i][col + j].piece = piece_copy;
-				grid->cells[row + i][col + j].locked = lock;
+				get_grid_cell(grid, row + i, col + j)->piece_ref = ref;
+				if (lock) {
+					set_cell_lock(grid, row + i, col + j, true); // Position was validated, so the cells are already unlocked otherwise
+				}
 			}
 		}
 	}
@@ -345,57 +543,28 @@ static bool insert_piece(Grid* grid, Piece* piece, bool lock) {
 	return true;
 }
 
-static bool validate_grid_position(Grid* grid, int row, int col) {
-	return row >= 0 && row < grid->height && col >= 0 && col < grid->width && !grid->cells[row][col].locked;
-}
-
 static bool allocate_cells(Grid* grid) {
-	grid->cells = malloc(sizeof(Cell*) * grid->height);
+	// Zeroed cells are empty, unlocked and unmarked
+	grid->cells = calloc(grid->width * grid->height, sizeof(Cell));
 	if (!grid->cells) {
 		fprintf(stderr, "Error: Failed to allocate memory for Grid cells\n");
 		free(grid);
 		return false;
 	}
-	for (int i = 0; i < grid->height; i++) {
-		grid->cells[i] = malloc(sizeof(Cell) * grid->width);
-		if (!grid->cells[i]) {
-			fprintf(stderr, "Error: Failed to allocate memory for Grid cells\n");
-			deallocate_cells(grid->cells, i);
-			free(grid);
-			return false;
-		}
-		init_cells_in_row(grid->cells[i], grid->width);
-	}
 	return true;
 }
 
-static void deallocate_cells(Cell** cells, int height) {
-	for (int i = 0; i < height; i++) {
-		free(cells[i]);
-	}
-	free(cells);
-}
-
-static void init_cells_in_row(Cell* cells, int width) {
-	for (int i = 0; i < width; i++) {
-		cells[i].piece = NULL;
-		cells[i].locked = false;
-		cells[i].shadow = false;
-		cells[i].x = false;
-	}
-}
-
 //static void test_print(Grid* grid) {
 //	// Print the state of the board for debugging
 //	for (int i = 0; i < grid->height; i++) {
 //		for (int j = 0; j < grid->width; j++) {
-//			if (grid->cells[i][j].piece && grid->cells[i][j].locked) {
+//			if (get_grid_cell(grid, i, j)->piece_ref && get_grid_cell(grid, i, j)->locked) {
 //				printf("X");
 //			}
-//			else if (grid->cells[i][j].piece && !grid->cells[i][j].locked) {
+//			else if (get_grid_cell(grid, i, j)->piece_ref && !get_grid_cell(grid, i, j)->locked) {
 //				printf("P");
 //			}
-//			else if (!grid->cells[i][j].piece && grid->cells[i][j].locked) {
+//			else if (!get_grid_cell(grid, i, j)->piece_ref && get_grid_cell(grid, i, j)->locked) {
 //				printf("L");
 //			}
 //			else {
@@ -416,13 +585,13 @@ static void init_cells_in_row(Cell* cells, int width) {
 //	fprintf(file, "Grid State: %s at index %d\n", label, index);
 //	for (int i = 0; i < grid->height; i++) {
 //		for (int j = 0; j < grid->width; j++) {
-//			if (grid->cells[i][j].piece && grid->cells[i][j].locked) {
+//			if (get_grid_cell(grid, i, j)->piece_ref && get_grid_cell(grid, i, j)->locked) {
 //				fputc('X', file);
 //			}
-//			else if (grid->cells[i][j].piece && !grid->cells[i][j].locked) {
+//			else if (get_grid_cell(grid, i, j)->piece_ref && !get_grid_cell(grid, i, j)->locked) {
 //				fputc('P', file);
 //			}
-//			else if (!grid->cells[i][j].piece && grid->cells[i][j].locked) {
+//			else if (!get_grid_cell(grid, i, j)->piece_ref && get_grid_cell(grid, i, j)->locked) {
 //				fputc('L', file);
 //			}
 //			else {
@@ -438,68 +607,55 @@ static void init_cells_in_row(Cell* cells, int width) {
 
 int check_and_mark_full_rows(Grid* grid) {
 	int cleared_rows = 0;
-	for (int row = 0; row < grid->height; row++) {
-		bool row_full = true;
-		for (int col = 0; col < grid->width; col++) {
-			if (!grid->cells[row][col].locked) {
-				row_full = false;
-				break;
-			}
-		}
-		if (row_full) {
+	if (grid->column_tops_dirty) {
+		rebuild_column_tops(grid);
+	}
+	// Rows above the stack are empty so they can't be full
+	for (int row = grid->stack_top; row < grid->height; row++) {
+		if (is_row_full(grid, row)) {
 			// Mark the row as full
 			grid->full_rows[row] = 1;
 			cleared_rows++;
 		}
 	}
-	grid->fade_start_time = cleared_rows > 0 ? SDL_GetTicks() : 0; // Start the fade timer
-
 	return cleared_rows;
 }
 
-// Handles the destruction of the original piece and insertions of the new pieces
+// Splits a piece around an emptied local row. The piece keeps the rows above and a new piece from the pool takes the rows below.
 static void split_grid_piece(Grid* grid, Piece* piece, int local_row) {
-	Piece* top_half = copy_piece_region(piece, 0, 0, local_row, piece->width);
-	Piece* bottom_half = copy_piece_region(piece, local_row + 1, 0, piece->height - local_row - 1, piece->width);
-
-	top_half->row_pos = piece->row_pos;
-	top_half->col_pos = piece->col_pos;
+	Piece* bottom_half = acquire_piece(grid->piece_pool);
+	SDL_assert(bottom_half); // Pool is sized so this can't happen
+	init_piece_region(bottom_half, piece, local_row + 1, 0, piece->height - local_row - 1, piece->width);
 	bottom_half->row_pos = piece->row_pos + local_row + 1;
 	bottom_half->col_pos = piece->col_pos;
 
-	// Reassign grid cell pointers to the new pieces
-	for (int r = 0; r < top_half->height; r++) {
-		for (int c = 0; c < top_half->width; c++) {
-			if (top_half->shape[r * top_half->width + c]) {
-				grid->cells[top_half->row_pos + r][piece->col_pos + c].piece = top_half;
-			}
-		}
+	// Shapes are row major with the same width, so the top half is just the first local_row rows
+	for (int r = local_row; r < piece->height; r++) {
+		piece->row_masks[r] = 0;
 	}
+	piece->height = local_row;
 
+	// Only the cells below the cut change owner
+	Uint32 bottom_ref = piece_ref(grid, bottom_half);
 	for (int r = 0; r < bottom_half->height; r++) {
 		for (int c = 0; c < bottom_half->width; c++) {
 			if (bottom_half->shape[r * bottom_half->width + c]) {
-				grid->cells[bottom_half->row_pos + r][piece->col_pos + c].piece = bottom_half;
+				get_grid_cell(grid, bottom_half->row_pos + r, bottom_half->col_pos + c)->piece_ref = bottom_ref;
 			}
 		}
 	}
 
-	add_to_dynamic_array(grid->locked_pieces, top_half);
 	add_to_dynamic_array(grid->locked_pieces, bottom_half);
-
-	// Remove old piece from tracking
-	remove_from_dynamic_array(grid->locked_pieces, piece);
-	destroy_piece(piece);
 }
 
 void clear_full_rows(Grid* grid) {
 	for (int row = 0; row < grid->height; row++) {
 		if (grid->full_rows[row]) {
-			DynamicArray* pieces_to_split = create_dynamic_array(10, NULL);
+			int split_count = 0;
 			// Clear the row
 			for (int col = 0; col < grid->width; col++) {
-				if (grid->cells[row][col].piece) {
-					Piece* piece = grid->cells[row][col].piece;
+				if (get_grid_cell(grid, row, col)->piece_ref) {
+					Piece* piece = get_cell_piece(grid, row, col);
 
 					// Convert global grid coordinates to local piece coordinates
 					int local_row = row - piece->row_pos;
@@ -508,6 +664,7 @@ void clear_full_rows(Grid* grid) {
 					// Delete the part of the piece that is in the row
 					if (local_row >= 0 && local_row < piece->height && local_col >= 0 && local_col < piece->width) {
 						piece->shape[local_row * piece->width + local_col] = false;
+						piece->row_masks[local_row] &= ~(1 << local_col);
 					}
 
 					// Check if the piece spans both above and below
@@ -534,21 +691,26 @@ void clear_full_rows(Grid* grid) {
 						}
 					}
 
-					if (has_above && has_below && !dynamic_array_contains(pieces_to_split, piece)) {
-						add_to_dynamic_array(pieces_to_split, piece);
+					if (has_above && has_below) {
+						bool queued = false;
+						for (int j = 0; j < split_count && !queued; j++) {
+							queued = grid->split_pieces[j] == piece;
+						}
+						if (!queued) {
+							grid->split_pieces[split_count++] = piece;
+						}
 					}
 
-					grid->cells[row][col].piece = NULL;
-					grid->cells[row][col].locked = false;
+					get_grid_cell(grid, row, col)->piece_ref = CELL_NO_PIECE;
+					set_cell_lock(grid, row, col, false);
 				}
 			}
-			for (int j = 0; j < pieces_to_split->size; j++) {
-				// Piece is split! Create two new pieces
-				Piece* piece = get_from_dynamic_array(pieces_to_split, j);
+			for (int j = 0; j < split_count; j++) {
+				// Piece is split! Cut it in two
+				Piece* piece = grid->split_pieces[j];
 				int local_row = row - piece->row_pos;
-				split_grid_piece(grid, piece, local_row); // Handles the destruction of the original piece and insertions of the new pieces
+				split_grid_piece(grid, piece, local_row);
 			}
-			destroy_dynamic_array(pieces_to_split);
 
 			grid->full_rows[row] = 0;
 		}
@@ -560,8 +722,8 @@ static void clear_piece_pointers(Grid* grid, Piece* piece) {
 	for (int k = 0; k < piece->height; k++) {
 		for (int l = 0; l < piece->width; l++) {
 			if (piece->shape[k * piece->width + l]) {
-				SDL_assert(grid->cells[k + piece->row_pos][l + piece->col_pos].piece == piece);
-				grid->cells[k + piece->row_pos][l + piece->col_pos].piece = NULL;
+				SDL_assert(get_cell_piece(grid, k + piece->row_pos, l + piece->col_pos) == piece);
+				get_grid_cell(grid, k + piece->row_pos, l + piece->col_pos)->piece_ref = CELL_NO_PIECE;
 			}
 		}
 	}
@@ -571,81 +733,112 @@ static void set_lock(Piece* piece, Grid* grid, bool lock) {
 	for (int l = 0; l < piece->height; l++) {
 		for (int m = 0; m < piece->width; m++) {
 			if (piece->shape[l * piece->width + m]) {
-				grid->cells[l + piece->row_pos][m + piece->col_pos].locked = lock;
+				set_cell_lock(grid, l + piece->row_pos, m + piece->col_pos, lock);
 			}
 		}
 	}
 }
 
-static bool is_row_empty(Grid* grid, int row) {
-	for (int col = 0; col < grid->width; col++) {
-		if (grid->cells[row][col].piece) {
-			return false;
+// Lets one locked piece fall as far as it can. Pieces resting on cells it vacated are queued to settle again.
+// Returns how many pieces were queued.
+static int settle_piece(Grid* grid, int slot, int* queue_tail) {
+	int capacity = grid->piece_pool->capacity;
+	int queued = 0;
+	Piece* piece = &grid->piece_pool->pieces[slot];
+	int row = piece->row_pos;
+	int col = piece->col_pos;
+	set_lock(piece, grid, false);
+	int new_row = row;
+	while (!piece_collides(grid, piece, new_row + 1, col)) {
+		new_row++;
+	}
+	if (new_row == row) {
+		set_lock(piece, grid, true);
+		return 0;
+	}
+
+	for (int i = 0; i < piece->height; i++) {
+		for (int j = 0; j < piece->width; j++) {
+			bool own_cell_above = i > 0 && piece->shape[(i - 1) * piece->width + j];
+			if (!piece->shape[i * piece->width + j] || own_cell_above || row + i == 0) {
+				continue;
+			}
+			Cell* above = get_grid_cell(grid, row + i - 1, col + j);
+			if (above->locked && above->piece_ref >= CELL_POOL_OFFSET) {
+				int above_slot = above->piece_ref - CELL_POOL_OFFSET;
+				if (!grid->gravity_queued[above_slot]) {
+					grid->gravity_queued[above_slot] = true;
+					grid->gravity_queue[*queue_tail] = above_slot;
+					*queue_tail = (*queue_tail + 1) % capacity;
+					queued++;
+				}
+			}
 		}
 	}
-	return true;
+
+	clear_piece_pointers(grid, piece);
+	piece->row_pos = new_row;
+	insert_piece(grid, piece, true);
+	return queued;
 }
 
 void drop_all_pieces(Grid* grid) {
-	int num_empty_rows = 0;
-	int index = 0;
-	DynamicArray* pieces_to_drop = create_dynamic_array(10, NULL);
+	PiecePool* pool = grid->piece_pool;
+	int capacity = pool->capacity;
+	int* queue = grid->gravity_queue;
+	int* shift = grid->gravity_shift;
+	int queue_size = 0;
+
+	// Gather pieces bottom up so they are ordered by their lowest row, and note how many completely empty rows are below each one.
+	int empty_rows_below = 0;
 	for (int row = grid->height - 1; row >= 0; row--) {
-		// Gather pieces to drop
-		for (int col = 0; col < grid->width; col++) {
-			if (grid->cells[row][col].piece) {
-				Piece* piece = grid->cells[row][col].piece;
-				if (!dynamic_array_contains(pieces_to_drop, piece)) {
-					add_to_dynamic_array(pieces_to_drop, piece);
-				}
-			}
+		if (is_row_empty(grid, row)) {
+			empty_rows_below++;
+			continue;
 		}
-		if (is_row_empty(grid, row) || row == 0) {
-			// Clear these pieces and set the new location to piece property
-			for (int i = index; i < pieces_to_drop->size; i++) {
-				Piece* piece = get_from_dynamic_array(pieces_to_drop, i);
-				// Drop the piece down by the number of empty rows
-				set_lock(piece, grid, false);
-				clear_piece_pointers(grid, piece);
-				piece->row_pos += num_empty_rows;
+		Uint64* row_bits = get_row_bits(grid, row);
+		for (int w = 0; w < grid->row_words; w++) {
+			Uint64 bits = row_bits[w];
+			while (bits) {
+				int col = w * 64 + count_trailing_zeros(bits);
+				bits &= bits - 1;
+				int slot = get_grid_cell(grid, row, col)->piece_ref - CELL_POOL_OFFSET;
+				if (!grid->gravity_queued[slot]) {
+					grid->gravity_queued[slot] = true;
+					shift[queue_size] = empty_rows_below;
+					queue[queue_size++] = slot;
+				}
 			}
-			num_empty_rows++;
-			index = pieces_to_drop->size;
 		}
 	}
 
-	// Insert pieces at new location
-	for (int i = 0; i < pieces_to_drop->size; i++) {
-		Piece* piece = get_from_dynamic_array(pieces_to_drop, i);
-		insert_piece(grid, piece, true);
-	}
-
-	destroy_dynamic_array(pieces_to_drop);
-
-
-	// Now go over each piece and see if it can drop further. While loop is for very rare cases where a piece can drop further after another piece has dropped.
-	bool can_drop_further = true;
-	while (can_drop_further) {
-		can_drop_further = false;
-		for (int i = 0; i < grid->locked_pieces->size; i++) {
-			Piece* piece = get_from_dynamic_array(grid->locked_pieces, i);
+	// Collapse the empty rows. Everything above an empty row moves down together, so pieces only held up by each other come along too.
+	for (int i = 0; i < queue_size; i++) {
+		if (shift[i]) {
+			Piece* piece = &pool->pieces[queue[i]];
 			set_lock(piece, grid, false);
 			clear_piece_pointers(grid, piece);
-			drop_piece_on_grid(grid, piece, true);
+			piece->row_pos += shift[i];
 		}
-		// Check if any piece can drop further
-		for (int i = 0; i < grid->locked_pieces->size; i++) {
-			Piece* piece = get_from_dynamic_array(grid->locked_pieces, i);
-			set_lock(piece, grid, false);
-			if (validate_piece_at_position(grid, piece, piece->row_pos + 1, piece->col_pos)) {
-				set_lock(piece, grid, true);
-				can_drop_further = true;
-				break;
-			}
-			set_lock(piece, grid, true);
+	}
+	for (int i = 0; i < queue_size; i++) {
+		if (shift[i]) {
+			insert_piece(grid, &pool->pieces[queue[i]], true);
 		}
 	}
 
+	// Now let each piece fall on its own, lowest first. A piece is only revisited when something it rested on moved,
+	// which replaces rescanning every piece until nothing moves.
+	int head = 0;
+	int tail = queue_size % capacity;
+	int pending = queue_size;
+	while (pending > 0) {
+		int slot = queue[head];
+		head = (head + 1) % capacity;
+		grid->gravity_queued[slot] = false;
+		pending += settle_piece(grid, slot, &tail) - 1;
+	}
+
 	/// Debug check
 	// For each piece assert that it can't drop further
 	//for (int i = 0; i < grid->locked_pieces->size; i++) {
@@ -654,17 +847,15 @@ void drop_all_pieces(Grid* grid) {
 	//	SDL_assert(!validate_piece_at_position(grid, piece, piece->row_pos + 1, piece->col_pos));
 	//	set_lock(piece, grid, true);
 	//}
-
 }
 
-
 static void remove_empty_pieces(Grid* grid) {
 	for (int i = 0; i < grid->locked_pieces->size; i++) {
 		Piece* piece = (Piece*)grid->locked_pieces->items[i];
 
 		if (is_piece_empty(piece)) {
 			remove_from_dynamic_array(grid->locked_pieces, piece);
-			destroy_piece(piece);
+			release_piece(grid->piece_pool, piece);
 			//printf("Removed empty piece\n");
 			i--; // Adjust index since we removed an item
 		}
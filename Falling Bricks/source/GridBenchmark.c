@@ -0,0 +1,208 @@
+#include "GridBenchmark.h"
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "BoardFeatures.h"
+#include "Constants.h"
+#include "Grid.h"
+#include "GridRenderer.h"
+#include "Piece.h"
+
+typedef struct {
+	int width;
+	int height;
+} BoardSize;
+
+static const BoardSize benchmark_sizes[] = {
+	{ BOARD_WIDTH, BOARD_HEIGHT },
+	{ 64, 128 },
+	{ 128, 512 },
+	{ MAX_BOARD_WIDTH, MAX_BOARD_HEIGHT }
+};
+
+static double seconds_since(Uint64 start) {
+	return (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+}
+
+static void print_result(const BoardSize* size, const char* operation, double seconds, int count) {
+	double micros = seconds * 1e6 / count;
+	int area = size->width * size->height;
+	printf("%4dx%-5d %8d  %-22s %12.2f us %10.3f ns/cell\n", size->width, size->height, area, operation, micros, micros * 1000 / area);
+}
+
+static Random benchmark_random;
+
+static void random_piece(Grid* grid, Piece* piece) {
+	init_piece(piece, random_piece_type(&benchmark_random));
+	set_piece_rotation(piece, random_int(&benchmark_random, 4));
+	piece->row_pos = 0;
+	piece->col_pos = random_int(&benchmark_random, grid->width - piece->width + 1);
+}
+
+// Drops pieces in random columns until the stack is fill_rows high, like a messy game. Returns how many were dropped.
+static int fill_grid(Grid* grid, int fill_rows) {
+	Piece piece;
+	int dropped = 0;
+	for (int attempts = grid->width * grid->height; attempts > 0 && grid->stack_top > grid->height - fill_rows; attempts--) {
+		random_piece(grid, &piece);
+		if (add_piece_to_grid(grid, &piece, true, true)) {
+			dropped++;
+		}
+	}
+	return dropped;
+}
+
+// Plugs every hole in the bottom rows with single cells so they are full
+static void fill_bottom_rows(Grid* grid, int rows) {
+	Piece line, cell;
+	init_piece(&line, LINE);
+	init_piece_region(&cell, &line, 0, 0, 1, 1);
+	for (int row = grid->height - rows; row < grid->height; row++) {
+		for (int col = 0; col < grid->width; col++) {
+			cell.row_pos = row;
+			cell.col_pos = col;
+			if (validate_piece_position(grid, &cell)) {
+				add_piece_to_grid(grid, &cell, true, false);
+			}
+		}
+	}
+}
+
+// Worst case for gravity: rows of 2 wide bricks laid like a brick wall, with some left out, hanging over a gap above
+// full rows. A column of single cells down the left edge keeps the gap's rows from being empty, so they don't just
+// collapse. Once the full rows clear, every brick has to fall on its own, and each lands only after the ones under it.
+static void build_cascade(Grid* grid, int full_rows, int gap_rows) {
+	Piece line, brick, cell;
+	init_piece(&line, LINE);
+	init_piece_region(&brick, &line, 0, 0, 1, 2);
+	init_piece_region(&cell, &line, 0, 0, 1, 1);
+	clear_grid(grid);
+	fill_bottom_rows(grid, full_rows);
+	int wall_bottom = grid->height - full_rows - gap_rows - 1;
+	int wall_top = grid->height / 2;
+	for (int row = wall_top; row < grid->height - full_rows; row++) {
+		cell.row_pos = row;
+		cell.col_pos = 0;
+		add_piece_to_grid(grid, &cell, true, false);
+	}
+	for (int row = wall_top; row <= wall_bottom; row++) {
+		for (int col = 1 + row % 2; col + 1 < grid->width; col += 2) {
+			if (random_int(&benchmark_random, 4) == 0) {
+				continue; // A missing brick lets the ones above fall further than the rest
+			}
+			brick.row_pos = row;
+			brick.col_pos = col;
+			add_piece_to_grid(grid, &brick, true, false);
+		}
+	}
+}
+
+static void benchmark_board(const BoardSize* size, SDL_Renderer* renderer) {
+	Grid* grid = create_grid(size->width, size->height, true, true);
+	if (!grid) {
+		return;
+	}
+	Piece piece;
+
+	Uint64 start = SDL_GetPerformanceCounter();
+	int dropped = fill_grid(grid, size->height / 2);
+	print_result(size, "drop and lock", seconds_since(start), MAX(1, dropped));
+
+	const int collision_tests = 200000;
+	random_piece(grid, &piece);
+	start = SDL_GetPerformanceCounter();
+	int valid = 0;
+	for (int i = 0; i < collision_tests; i++) {
+		valid += validate_piece_at_position(grid, &piece, i % grid->height, i % (grid->width - piece.width + 1));
+	}
+	print_result(size, "collision test", seconds_since(start), collision_tests);
+
+	// A search measures many boards at once, so time a full batch and report the cost per board
+	const Uint64* feature_boards[64];
+	BoardFeatures features[64];
+	for (int i = 0; i < 64; i++) {
+		feature_boards[i] = grid->row_bits;
+	}
+	const int feature_batches = 200;
+	start = SDL_GetPerformanceCounter();
+	for (int i = 0; i < feature_batches; i++) {
+		get_board_features(feature_boards, 64, grid->width, grid->height, features);
+		valid += features[i % 64].holes;
+	}
+	print_result(size, "features (64 batch)", seconds_since(start), feature_batches * 64);
+
+	// What a frame costs while the player moves: undo the last piece and shadow, draw the new ones
+	const int moves = 20000;
+	start = SDL_GetPerformanceCounter();
+	for (int i = 0; i < moves; i++) {
+		piece.col_pos = i % (grid->width - piece.width + 1);
+		clear_unlocked_cells(grid);
+		add_piece_to_grid(grid, &piece, false, false);
+	}
+	print_result(size, "move with shadow", seconds_since(start), moves);
+	clear_unlocked_cells(grid);
+
+	const int clears = 5;
+	double clear_seconds = 0;
+	for (int i = 0; i < clears; i++) {
+		fill_bottom_rows(grid, 4);
+		start = SDL_GetPerformanceCounter();
+		check_and_mark_full_rows(grid);
+		clear_full_rows(grid);
+		drop_all_pieces(grid);
+		clear_seconds += seconds_since(start);
+	}
+	print_result(size, "4 line clear", clear_seconds, clears);
+
+	const int cascades = 3;
+	double cascade_seconds = 0;
+	for (int i = 0; i < cascades; i++) {
+		build_cascade(grid, 4, 4);
+		start = SDL_GetPerformanceCounter();
+		check_and_mark_full_rows(grid);
+		clear_full_rows(grid);
+		drop_all_pieces(grid);
+		cascade_seconds += seconds_since(start);
+	}
+	print_result(size, "4 lines + cascade", cascade_seconds, cascades);
+
+	if (renderer) {
+		int cell_width = MAX(1, MIN(CELL_SIZE, MIN(MAX_BOARD_PIXEL_WIDTH / size->width, MAX_BOARD_PIXEL_HEIGHT / size->height)));
+		const int frames = 20;
+		start = SDL_GetPerformanceCounter();
+		for (int i = 0; i < frames; i++) {
+			draw_grid(grid, 0, 0, cell_width, 4, 255, renderer);
+		}
+		print_result(size, "draw (software)", seconds_since(start), frames);
+	}
+
+	if (valid < 0) {
+		printf("%d\n", valid); // Keeps the collision loop from being optimized away
+	}
+	destroy_grid(grid);
+}
+
+void run_grid_benchmark() {
+	seed_random(&benchmark_random, 1); // Same boards every run
+	SDL_Surface* surface = SDL_CreateRGBSurface(0, WINDOW_WIDTH, WINDOW_HEIGHT * 2, 32, 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000);
+	SDL_Renderer* renderer = surface ? SDL_CreateSoftwareRenderer(surface) : NULL;
+	if (renderer) {
+		SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+	}
+	else {
+		fprintf(stderr, "Error: Could not create software renderer, skipping draw timings: %s\n", SDL_GetError());
+	}
+
+	printf("board          cells  operation                   time/op       per cell\n");
+	for (int i = 0; i < (int)(sizeof(benchmark_sizes) / sizeof(benchmark_sizes[0])); i++) {
+		benchmark_board(&benchmark_sizes[i], renderer);
+	}
+
+	if (renderer) {
+		SDL_DestroyRenderer(renderer);
+	}
+	if (surface) {
+		SDL_FreeSurface(surface);
+	}
+}
\ No newline at end of file
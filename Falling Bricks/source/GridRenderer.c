@@ -0,0 +1,195 @@
+#include "GridRenderer.h"
+#include "Constants.h"
+
+#define PREVIEW_PANEL_WIDTH 6 // Cells, wide enough for a line piece with a cell of padding each side
+#define PREVIEW_ROWS_PER_PIECE 3
+
+void draw_grid_border(SDL_Renderer* renderer, int origin_x, int origin_y, int inner_width, int inner_height, int border_width) {
+	if (!border_width) return;
+	SDL_SetRenderDrawColor(renderer, 128, 128, 128, SDL_ALPHA_OPAQUE);
+	SDL_Rect top_border = { origin_x, origin_y, inner_width + border_width * 2, border_width };
+	SDL_Rect bottom_border = { origin_x, origin_y + inner_height + border_width, inner_width + border_width * 2, border_width };
+	SDL_Rect left_border = { origin_x, origin_y + border_width, border_width, inner_height };
+	SDL_Rect right_border = { origin_x + inner_width + border_width, origin_y + border_width, border_width, inner_height };
+	SDL_RenderFillRect(renderer, &top_border);
+	SDL_RenderFillRect(renderer, &bottom_border);
+	SDL_RenderFillRect(renderer, &left_border);
+	SDL_RenderFillRect(renderer, &right_border);
+}
+
+void draw_cell_block(SDL_Renderer* renderer, const SDL_Rect* cell_rect, SDL_Color color, Uint8 alpha) {
+	int cell_width = cell_rect->w;
+	SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, alpha);
+	SDL_RenderFillRect(renderer, cell_rect);
+
+	if (cell_width < 8) {
+		return; // Outlines are cell_width / 8 thick, so there are none to draw
+	}
+
+	alpha >>= 1; // Shift bits once to the right to get half the value. Fast division using the power of C!
+
+	// Draw shadow / outline around block to make it look 3D from far
+	SDL_SetRenderDrawColor(renderer, 255, 255, 255, alpha);
+	SDL_Rect top_outline = { cell_rect->x, cell_rect->y, cell_width, cell_width / 8 };
+	SDL_Rect right_outline = { cell_rect->x + cell_width - cell_width / 8, cell_rect->y + cell_width / 8, cell_width / 8, cell_width - cell_width / 4 };
+	SDL_RenderFillRect(renderer, &top_outline);
+	SDL_RenderFillRect(renderer, &right_outline);
+
+	SDL_SetRenderDrawColor(renderer, 0, 0, 0, alpha);
+	SDL_Rect bottom_outline = { cell_rect->x, cell_rect->y + cell_width - cell_width / 8, cell_width, cell_width / 8 };
+	SDL_Rect left_outline = { cell_rect->x, cell_rect->y + cell_width / 8, cell_width / 8, cell_width - cell_width / 4 };
+	SDL_RenderFillRect(renderer, &bottom_outline);
+	SDL_RenderFillRect(renderer, &left_outline);
+}
+
+// Outlining every cell draws the same pixels as these two lines per column and per row, with far fewer draw calls
+static void draw_grid_lines(Grid* grid, int x, int y, int cell_width, SDL_Renderer* renderer) {
+	SDL_SetRenderDrawColor(renderer, 128, 128, 128, SDL_ALPHA_OPAQUE);
+	int right = x + grid->width * cell_width - 1;
+	int bottom = y + grid->height * cell_width - 1;
+	for (int j = 0; j < grid->width; j++) {
+		int left_edge = x + j * cell_width;
+		SDL_RenderDrawLine(renderer, left_edge, y, left_edge, bottom);
+		SDL_RenderDrawLine(renderer, left_edge + cell_width - 1, y, left_edge + cell_width - 1, bottom);
+	}
+	for (int i = 0; i < grid->height; i++) {
+		int top_edge = y + i * cell_width;
+		SDL_RenderDrawLine(renderer, x, top_edge, right, top_edge);
+		SDL_RenderDrawLine(renderer, x, top_edge + cell_width - 1, right, top_edge + cell_width - 1);
+	}
+}
+
+// Rows above the stack only need drawing where the unlocked piece, its shadow or x marks are
+static bool is_row_visible(Grid* grid, int row, int stack_top) {
+	if (row >= stack_top || (row >= grid->x_top && row <= grid->x_bottom)) {
+		return true;
+	}
+	if (!grid->has_drawn_piece) {
+		return false;
+	}
+	const Piece* piece = &grid->drawn_piece;
+	return (row >= piece->row_pos && row < piece->row_pos + piece->height) ||
+		(grid->drawn_shadow_row >= 0 && row >= grid->drawn_shadow_row && row < grid->drawn_shadow_row + piece->height);
+}
+
+static void draw_x_mark(const SDL_Rect* cell_rect, SDL_Renderer* renderer) {
+	int cell_width = cell_rect->w;
+	SDL_SetRenderDrawColor(renderer, 210, 0, 0, 255);
+	// Top left to bottom right
+	// To draw a thicker line, draw multiple lines with a 1 pixel offset
+	for (int k = -3; k < 4; k++) {
+		int x = MAX(cell_rect->x, cell_rect->x + k) + 1;
+		int y = MAX(cell_rect->y, cell_rect->y - k) + 1;
+		int x2 = MIN(cell_rect->x + cell_width, cell_rect->x + cell_width + k) - 2;
+		int y2 = MIN(cell_rect->y + cell_width, cell_rect->y + cell_width - k) - 2;
+		SDL_RenderDrawLine(renderer, x, y, x2, y2);
+	}
+
+	// Bottom left to top right
+	for (int k = -3; k < 4; k++) {
+		int x = MAX(cell_rect->x, cell_rect->x + k) + 1;
+		int y = MIN(cell_rect->y + cell_width, cell_rect->y + cell_width + k) - 2;
+		int x2 = MIN(cell_rect->x + cell_width, cell_rect->x + cell_width + k) - 2;
+		int y2 = MAX(cell_rect->y, cell_rect->y + k) + 1;
+		SDL_RenderDrawLine(renderer, x, y, x2, y2);
+	}
+}
+
+static void draw_grid_row(Grid* grid, int row, int x, int y, int cell_width, Uint8 full_row_alpha, SDL_Renderer* renderer) {
+
+	// Blocks first. Small cells have no outlines, so neighbouring cells of the same colour are filled as one rect.
+	bool merge_runs = cell_width < 8;
+	for (int j = 0; j < grid->width; j++) {
+		Piece* piece = get_cell_piece(grid, row, j);
+		if (!piece) {
+			continue;
+		}
+		Uint8 alpha = grid->full_rows[row] ? full_row_alpha : piece->color.a;
+		SDL_Rect cell_rect = { x + j * cell_width, y, cell_width, cell_width };
+		if (!merge_runs) {
+			draw_cell_block(renderer, &cell_rect, piece->color, alpha);
+			continue;
+		}
+		SDL_Color color = piece->color;
+		while (j + 1 < grid->width) {
+			Piece* next = get_cell_piece(grid, row, j + 1);
+			if (!next || next->color.r != color.r || next->color.g != color.g || next->color.b != color.b ||
+				(!grid->full_rows[row] && next->color.a != alpha)) {
+				break;
+			}
+			cell_rect.w += cell_width;
+			j++;
+		}
+		SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, alpha);
+		SDL_RenderFillRect(renderer, &cell_rect);
+	}
+
+	// Overlays go on top. Cells never overlap, so drawing them after every block in the row looks the same as per cell.
+	for (int j = 0; j < grid->width; j++) {
+		Cell* cell = get_grid_cell(grid, row, j);
+		if (!cell->shadow && !cell->locked && !cell->x) {
+			continue;
+		}
+		SDL_Rect cell_rect = { x + j * cell_width, y, cell_width, cell_width };
+		if (cell->shadow) {
+			SDL_SetRenderDrawColor(renderer, 128, 128, 128, 128);
+			SDL_RenderFillRect(renderer, &cell_rect);
+		}
+		// For debugging, normally this would be an illegal state. Helpful to visualize if row clearing messes up.
+		if (cell->locked && !cell->piece_ref) {
+			SDL_SetRenderDrawColor(renderer, 255, 255, 255, 128);
+			SDL_RenderFillRect(renderer, &cell_rect);
+		}
+		if (cell->x) {
+			draw_x_mark(&cell_rect, renderer);
+		}
+	}
+}
+
+// Draws in layers, each across the whole grid, and skips rows with nothing in them so large boards stay cheap to draw
+void draw_grid(Grid* grid, int origin_x, int origin_y, int cell_width, int border_width, Uint8 full_row_alpha, SDL_Renderer* renderer) {
+
+	draw_grid_border(renderer, origin_x, origin_y, grid->width * cell_width, grid->height * cell_width, border_width);
+
+	int x = origin_x + border_width;
+	int y = origin_y + border_width;
+
+	if (grid->is_game_board && is_near_height_limit(grid)) {
+		SDL_SetRenderDrawColor(renderer, 255, 0, 0, 128);
+		SDL_Rect warning_rect = { x, y, grid->width * cell_width, 2 * cell_width };
+		SDL_RenderFillRect(renderer, &warning_rect);
+	}
+
+	// Lines would cover most of a tiny cell
+	if (grid->show_grid_lines && cell_width >= 4) {
+		draw_grid_lines(grid, x, y, cell_width, renderer);
+	}
+
+	int stack_top = get_stack_top(grid);
+	for (int i = 0; i < grid->height; i++) {
+		if (is_row_visible(grid, i, stack_top)) {
+			draw_grid_row(grid, i, x, y + i * cell_width, cell_width, full_row_alpha, renderer);
+		}
+	}
+}
+
+void draw_piece_queue(const PieceQueue* queue, int x, int y, int cell_width, int max_height, int border_width, SDL_Renderer* renderer) {
+	int rows = queue->length * PREVIEW_ROWS_PER_PIECE + 1;
+	cell_width = MIN(cell_width, max_height / rows);
+
+	draw_grid_border(renderer, x, y, PREVIEW_PANEL_WIDTH * cell_width, rows * cell_width, border_width);
+
+	Piece piece;
+	for (int i = 0; i < queue->length; i++) {
+		init_piece(&piece, peek_piece_type(queue, i));
+		int piece_x = x + border_width + cell_width; // One cell of padding on the left
+		int piece_y = y + border_width + (i * PREVIEW_ROWS_PER_PIECE + 1) * cell_width;
+		for (int row = 0; row < piece.height; row++) {
+			for (int col = 0; col < piece.width; col++) {
+				if (!piece.shape[row * piece.width + col]) continue;
+				SDL_Rect cell_rect = { piece_x + col * cell_width, piece_y + row * cell_width, cell_width, cell_width };
+				draw_cell_block(renderer, &cell_rect, piece.color, piece.color.a);
+			}
+		}
+	}
+}
@@ -0,0 +1,100 @@
+#include "InputQueue.h"
+#include "Constants.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Acquire and release where the compiler has them. Elsewhere volatile, which MSVC gives acquire and release meaning on
+// x86 and x64.
+static inline Uint32 load_index(const Uint32* index) {
+#if defined(__GNUC__) || defined(__clang__)
+	return __atomic_load_n(index, __ATOMIC_ACQUIRE);
+#else
+	return *(const volatile Uint32*)index;
+#endif
+}
+
+static inline void store_index(Uint32* index, Uint32 value) {
+#if defined(__GNUC__) || defined(__clang__)
+	__atomic_store_n(index, value, __ATOMIC_RELEASE);
+#else
+	*(volatile Uint32*)index = value;
+#endif
+}
+
+InputQueue* create_input_queue() {
+	InputQueue* queue = calloc(1, sizeof(InputQueue));
+	if (!queue) {
+		fprintf(stderr, "Error: Failed to allocate memory for InputQueue\n");
+		return NULL;
+	}
+	return queue;
+}
+
+bool push_input_event(InputQueue* queue, const InputEvent* event) {
+	Uint32 tail = queue->tail;
+	// Indices run freely and wrap, so tail - head is the count even across the wrap
+	if (tail - load_index(&queue->head) >= INPUT_QUEUE_CAPACITY) {
+		queue->dropped++;
+		return false;
+	}
+	queue->events[tail & (INPUT_QUEUE_CAPACITY - 1)] = *event;
+	store_index(&queue->tail, tail + 1);
+	return true;
+}
+
+bool pop_input_event_before(InputQueue* queue, Uint64 time, InputEvent* event) {
+	Uint32 head = queue->head;
+	if (head == load_index(&queue->tail)) {
+		return false;
+	}
+	const InputEvent* next = &queue->events[head & (INPUT_QUEUE_CAPACITY - 1)];
+	if (next->time >= time) {
+		return false;
+	}
+	*event = *next;
+	store_index(&queue->head, head + 1);
+	return true;
+}
+
+void clear_input_queue(InputQueue* queue) {
+	store_index(&queue->head, load_index(&queue->tail));
+}
+
+void record_input_latency(InputQueue* queue, const InputEvent* event, Uint64 applied_time) {
+	InputLatency* latency = &queue->latency;
+	Uint64 waited = applied_time > event->real_time ? applied_time - event->real_time : 0;
+	latency->count++;
+	latency->total += waited;
+	latency->max = MAX(latency->max, waited);
+	latency->histogram[MIN(waited / INPUT_LATENCY_BUCKET, INPUT_LATENCY_BUCKETS - 1)]++;
+}
+
+Uint64 get_input_latency_percentile(const InputLatency* latency, double fraction) {
+	if (latency->count == 0) {
+		return 0;
+	}
+	Uint64 wanted = (Uint64)(fraction * latency->count);
+	Uint64 seen = 0;
+	for (int i = 0; i < INPUT_LATENCY_BUCKETS - 1; i++) {
+		seen += latency->histogram[i];
+		if (seen >= wanted && seen > 0) {
+			return MIN((Uint64)(i + 1) * INPUT_LATENCY_BUCKET, latency->max);
+		}
+	}
+	return latency->max;
+}
+
+void print_input_latency(const InputQueue* queue) {
+	const InputLatency* latency = &queue->latency;
+	if (latency->count == 0) {
+		return;
+	}
+	printf("Input latency over %llu inputs: mean %.2f ms, median %.1f ms, 99%% %.1f ms, worst %.2f ms. %llu dropped.\n",
+		(unsigned long long)latency->count, latency->total / 1000.0 / latency->count,
+		get_input_latency_percentile(latency, 0.5) / 1000.0, get_input_latency_percentile(latency, 0.99) / 1000.0,
+		latency->max / 1000.0, (unsigned long long)queue->dropped);
+}
+
+void destroy_input_queue(InputQueue* queue) {
+	free(queue);
+}
@@ -42,14 +42,3 @@ void time_formater(char* mins_secs_buffer, char* millis_buffer, size_t size_of_b
 	snprintf(mins_secs_buffer, size_of_buffers, "%d:%02d", minutes, seconds);
 	snprintf(millis_buffer, size_of_buffers, ".%03d", milliseconds);
 }
-
-const char* get_row_clear_label(int rows) {
-	switch (rows) {
-	case 1: return "SINGLE";
-	case 2: return "DOUBLE";
-	case 3: return "TRIPLE";
-	case 4: return "QUADRUPLE";
-	default: return "";
-	}
-}
-
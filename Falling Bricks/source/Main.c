@@ -1,12 +1,18 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include <SDL.h>
 #include <time.h>
 
 #include "Constants.h"
+#include "Clock.h"
 #include "Paths.h"
 #include "Game.h"
+#include "GridBenchmark.h"
+#include "GameBatch.h"
+#include "MoveGen.h"
+#include "ReplayVerifier.h"
 
 #ifdef _DEBUG
 	#define _CRTDBG_MAP_ALLOC
@@ -21,6 +27,7 @@
 SDL_Window* window = NULL;
 SDL_Renderer* renderer = NULL;
 bool game_is_running = false;
+bool renderer_vsync = false; // Presents wait for the display's refresh, so frames need no cap of their own
 
 bool init_window(SDL_Window** window, SDL_Renderer** renderer) {
 	if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) != 0) {
@@ -41,11 +48,14 @@ bool init_window(SDL_Window** window, SDL_Renderer** renderer) {
 		return false;
 	}
 	//SDL_SetWindowFullscreen(window, SDL_WINDOW_FULLSCREEN_DESKTOP);
-	SDL_Renderer* new_renderer = SDL_CreateRenderer(new_window, -1, SDL_RENDERER_ACCELERATED);
+	// Frames are drawn at the display's refresh rate, the game steps at its own fixed rate in update
+	SDL_Renderer* new_renderer = SDL_CreateRenderer(new_window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
 	if (!new_renderer) {
 		fprintf(stderr, "Error creating SDL renderer.\n");
 		return false;
 	}
+	SDL_RendererInfo renderer_info;
+	renderer_vsync = SDL_GetRendererInfo(new_renderer, &renderer_info) == 0 && (renderer_info.flags & SDL_RENDERER_PRESENTVSYNC);
 	SDL_SetRenderDrawBlendMode(new_renderer, SDL_BLENDMODE_BLEND);
 
 	// Set window icon
@@ -85,7 +95,96 @@ void main_loop() {
 #endif
 
 int main(int argc, char* args[]) {
-	srand(time(NULL));
+	// Pieces, songs and menu blocks all follow from this seed, so --seed N makes a session repeatable
+	Uint64 seed = (Uint64)time(NULL);
+	set_game_seed(seed);
+
+	// --board WxH plays on a custom board size, --benchmark times the grid operations and exits.
+	// --simulate N steps N headless games on --threads T threads (all CPUs by default), reports throughput and exits. The games
+	// use the --board, --seed and --bag given before or after it.
+	// --perft N counts every placement sequence N pieces deep with the move generator, reports its speed and exits.
+	// --bag deals pieces from shuffled bags of all seven instead of picking each one independently.
+	// --ai lets the computer play, for demos. A switches between it and the keyboard in game.
+	// --das MS and --arr MS set how long a held direction waits before repeating and how often it then moves, --arr 0
+	// moving straight to the wall. --sdf N makes a held soft drop N times as fast as gravity.
+	// --record DIR saves a replay of every game to DIR. --replay FILE watches one, --replay-speed N plays it N times as fast.
+	// --verify REPORT FILE... re-plays every FILE headless on --threads T threads, writes a JSON report and exits.
+	int simulate_games = 0;
+	int simulate_threads = 0;
+	int board_width = BOARD_WIDTH;
+	int board_height = BOARD_HEIGHT;
+	PieceRandomizer randomizer = RANDOMIZER_UNIFORM;
+	const char* verify_report = NULL;
+	int verify_first = argc;
+	for (int i = 1; i < argc; i++) {
+		int width, height;
+		if (strcmp(args[i], "--benchmark") == 0) {
+			run_grid_benchmark();
+			return EXIT_SUCCESS;
+		}
+		if (strcmp(args[i], "--perft") == 0 && i + 1 < argc) {
+			run_move_generator_perft(atoi(args[i + 1]));
+			return EXIT_SUCCESS;
+		}
+		if (strcmp(args[i], "--board") == 0 && i + 1 < argc && sscanf(args[i + 1], "%dx%d", &width, &height) == 2) {
+			if (set_board_size(width, height)) {
+				board_width = width;
+				board_height = height;
+			}
+			i++;
+		}
+		else if (strcmp(args[i], "--simulate") == 0 && i + 1 < argc) {
+			simulate_games = atoi(args[++i]);
+		}
+		else if (strcmp(args[i], "--threads") == 0 && i + 1 < argc) {
+			simulate_threads = atoi(args[++i]);
+		}
+		else if (strcmp(args[i], "--seed") == 0 && i + 1 < argc) {
+			seed = strtoull(args[++i], NULL, 10);
+			set_game_seed(seed);
+		}
+		else if (strcmp(args[i], "--bag") == 0) {
+			randomizer = RANDOMIZER_BAG;
+			set_bag_randomizer(true);
+		}
+		else if (strcmp(args[i], "--ai") == 0) {
+			set_ai_enabled(true);
+		}
+		else if (strcmp(args[i], "--das") == 0 && i + 1 < argc) {
+			set_auto_repeat_delay(atoi(args[++i]));
+		}
+		else if (strcmp(args[i], "--arr") == 0 && i + 1 < argc) {
+			set_auto_repeat_rate(atoi(args[++i]));
+		}
+		else if (strcmp(args[i], "--sdf") == 0 && i + 1 < argc) {
+			set_soft_drop_factor(atoi(args[++i]));
+		}
+		else if (strcmp(args[i], "--record") == 0 && i + 1 < argc) {
+			set_record_directory(args[++i]);
+		}
+		else if (strcmp(args[i], "--replay") == 0 && i + 1 < argc) {
+			if (!set_replay_file(args[++i])) {
+				return EXIT_FAILURE;
+			}
+		}
+		else if (strcmp(args[i], "--replay-speed") == 0 && i + 1 < argc) {
+			set_replay_speed(atoi(args[++i]));
+		}
+		else if (strcmp(args[i], "--verify") == 0 && i + 1 < argc) {
+			// Everything after the report path is a replay
+			verify_report = args[i + 1];
+			verify_first = i + 2;
+			break;
+		}
+	}
+	if (verify_report) {
+		bool all_matched = run_replay_verifier((const char* const*)args + verify_first, argc - verify_first, simulate_threads, verify_report);
+		return all_matched ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+	if (simulate_games > 0) {
+		run_game_batch_benchmark(simulate_games, board_width, board_height, seed, randomizer, simulate_threads);
+		return EXIT_SUCCESS;
+	}
 #ifdef _DEBUG
 	// Enable memory leak checks only in debug builds
 	_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
@@ -98,10 +197,18 @@ int main(int argc, char* args[]) {
 	emscripten_set_main_loop(main_loop, 0, 1);
 #else
 	// If running natively, use the traditional game loop
+	Clock frame_clock;
+	init_real_clock(&frame_clock);
 	while (game_is_running) {
+		Uint64 frame_start = get_clock_ms(&frame_clock);
 		process_input(&game_is_running);
 		update();
 		render(renderer);
+
+		Uint64 frame_time = get_clock_ms(&frame_clock) - frame_start;
+		if (!renderer_vsync && frame_time < FRAME_TARGET_TIME) {
+			SDL_Delay((Uint32)(FRAME_TARGET_TIME - frame_time));
+		}
 	}
 #endif
 
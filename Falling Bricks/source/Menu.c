@@ -3,6 +3,7 @@
 #include "Constants.h"
 #include "ResolutionContext.h"
 #include "Grid.h"
+#include "GridRenderer.h"
 #include "Piece.h"
 #include "FontContext.h"
 #include <SDL.h>
@@ -25,7 +26,7 @@ static bool create_grid_array(struct TitleMenu* menu) {
 
 static void create_grid_piece(struct TitleMenu* menu) {
 	// Create a grid for each floating block
-	Piece* piece = create_random_piece();
+	Piece* piece = create_random_piece(&menu->random);
 	Grid* floating_grid = create_grid(piece->width, piece->height, false, false);
 	SDL_FPoint* position = malloc(sizeof(SDL_FPoint));
 
@@ -42,7 +43,7 @@ static void create_grid_piece(struct TitleMenu* menu) {
 	destroy_piece(piece);
 
 	// Calculate x position for piece. Chose random position with a bias towards edges
-	float random = (float)rand() / RAND_MAX;
+	float random = random_float(&menu->random);
 	if (random <= 0.5f) {
 		// Bias towards the left edge
 		random = -sqrtf(0.25f - powf(random, 2)) + 0.5f;
@@ -58,7 +59,7 @@ static void create_grid_piece(struct TitleMenu* menu) {
 	position->y = -menu->res_context.y_offset / menu->res_context.scale_factor;
 	position->y -= 2 * CELL_SIZE;
 
-	menu->floating_grid_creation_time = SDL_GetTicks();
+	menu->floating_grid_creation_time = get_clock_ms(menu->clock);
 }
 
 static void draw_piece_grids(struct TitleMenu* menu, SDL_Renderer* renderer) {
@@ -68,11 +69,11 @@ static void draw_piece_grids(struct TitleMenu* menu, SDL_Renderer* renderer) {
 		int x = position->x * menu->res_context.scale_factor + menu->res_context.x_offset;
 		int y = position->y * menu->res_context.scale_factor + menu->res_context.y_offset;
 		int cell_width = CELL_SIZE * menu->res_context.scale_factor;
-		draw_grid(grid, x, y, cell_width, 0, renderer);
+		draw_grid(grid, x, y, cell_width, 0, 0, renderer);
 	}
 }
 
-struct TitleMenu* create_title_menu(ButtonCallback on_click[4]) {
+struct TitleMenu* create_title_menu(ButtonCallback on_click[4], Uint64 seed, const Clock* clock) {
 	struct TitleMenu* menu = malloc(sizeof(struct TitleMenu));
 	if (!menu) {
 		fprintf(stderr, "Error: Failed to allocate memory for TitleMenu\n");
@@ -83,6 +84,8 @@ struct TitleMenu* create_title_menu(ButtonCallback on_click[4]) {
 		free(menu);
 		return NULL;
 	}
+	seed_random(&menu->random, seed);
+	menu->clock = clock;
 
 	FontContext* font_context = get_font_context();
 	TTF_Font* title_font = font_context->title_font;
@@ -98,7 +101,7 @@ struct TitleMenu* create_title_menu(ButtonCallback on_click[4]) {
 	menu->buttons[2] = create_button(button_x, button_y + 300, button_width, button_height, button_color, on_click[2], "Endless", button_font);
 	menu->buttons[3] = create_button(button_x, button_y + 400, button_width, button_height, button_color, on_click[3], "Quit", button_font);
 	menu->res_context = get_resolution_context(WINDOW_WIDTH, WINDOW_HEIGHT);
-	menu->floating_grid_creation_time = SDL_GetTicks();
+	menu->floating_grid_creation_time = get_clock_ms(menu->clock);
 
 	SDL_Surface* title_surface = TTF_RenderText_Solid(title_font, "Falling Bricks", (SDL_Color) { 200, 175, 0, SDL_ALPHA_OPAQUE });
 	menu->title_texture = SDL_CreateTextureFromSurface(SDL_GetRenderer(SDL_GetWindowFromID(1)), title_surface);
@@ -139,9 +142,9 @@ void update_grid_positions(struct TitleMenu* menu, float delta_time) {
 			i--;
 		}
 	}
-	if (SDL_GetTicks() - menu->floating_grid_creation_time > BLOCK_INTERVAL) {
+	if (get_clock_ms(menu->clock) - menu->floating_grid_creation_time > BLOCK_INTERVAL) {
 		create_grid_piece(menu);
-		menu->floating_grid_creation_time = SDL_GetTicks();
+		menu->floating_grid_creation_time = get_clock_ms(menu->clock);
 	}
 }
 
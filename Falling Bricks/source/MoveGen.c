@@ -0,0 +1,302 @@
+#include "MoveGen.h"
+#include "Constants.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PERFT_MAX_DEPTH 8
+
+static int get_state(const MoveGenerator* generator, int rotation, int row, int col) {
+	return (rotation * generator->height + row) * generator->width + col;
+}
+
+static void decode_state(const MoveGenerator* generator, int state, int* rotation, int* row, int* col) {
+	*col = state % generator->width;
+	state /= generator->width;
+	*row = state % generator->height;
+	*rotation = state / generator->height;
+}
+
+static bool is_visited(const MoveGenerator* generator, int state) {
+	return (generator->visited[state / 64] >> (state % 64)) & 1;
+}
+
+static void set_visited(MoveGenerator* generator, int state) {
+	generator->visited[state / 64] |= (Uint64)1 << (state % 64);
+}
+
+MoveGenerator* create_move_generator(int width, int height) {
+	if (width <= 0 || width > MAX_GRID_WIDTH || height <= 0) {
+		fprintf(stderr, "Error: Invalid move generator dimensions %dx%d\n", width, height);
+		return NULL;
+	}
+	MoveGenerator* generator = calloc(1, sizeof(MoveGenerator));
+	if (!generator) {
+		fprintf(stderr, "Error: Failed to allocate memory for MoveGenerator\n");
+		return NULL;
+	}
+	generator->width = width;
+	generator->height = height;
+	generator->state_count = 4 * width * height;
+	generator->visited = calloc((generator->state_count + 63) / 64, sizeof(Uint64));
+	generator->queue = malloc(sizeof(int) * generator->state_count);
+	generator->parents = malloc(sizeof(int) * generator->state_count);
+	generator->parent_inputs = malloc(generator->state_count);
+	generator->placements = malloc(sizeof(Placement) * generator->state_count);
+	if (!generator->visited || !generator->queue || !generator->parents || !generator->parent_inputs || !generator->placements) {
+		fprintf(stderr, "Error: Failed to allocate move generator buffers\n");
+		destroy_move_generator(generator);
+		return NULL;
+	}
+	return generator;
+}
+
+void destroy_move_generator(MoveGenerator* generator) {
+	if (!generator) return;
+	free(generator->visited);
+	free(generator->queue);
+	free(generator->parents);
+	free(generator->parent_inputs);
+	free(generator->placements);
+	free(generator);
+}
+
+static bool same_shape(const Piece* a, const Piece* b) {
+	return a->width == b->width && a->height == b->height && memcmp(a->row_masks, b->row_masks, sizeof(a->row_masks)) == 0;
+}
+
+// Rotations that look the same are the same state. Rotating either of them also gives matching shapes, so nothing is lost.
+static void set_orientations(MoveGenerator* generator, enum PieceType type) {
+	for (int rotation = 0; rotation < 4; rotation++) {
+		Piece* piece = &generator->orientations[rotation];
+		init_piece(piece, type);
+		set_piece_rotation(piece, rotation);
+		generator->canonical_rotation[rotation] = rotation;
+		for (int other = 0; other < rotation; other++) {
+			if (same_shape(piece, &generator->orientations[other])) {
+				generator->canonical_rotation[rotation] = generator->canonical_rotation[other];
+				break;
+			}
+		}
+	}
+}
+
+static void visit(MoveGenerator* generator, int* queue_end, int state, int parent, MoveInput input) {
+	if (is_visited(generator, state)) {
+		return;
+	}
+	set_visited(generator, state);
+	generator->parents[state] = parent;
+	generator->parent_inputs[state] = (Uint8)input;
+	generator->queue[(*queue_end)++] = state;
+}
+
+static void visit_rotation(MoveGenerator* generator, Grid* grid, int* queue_end, int state, int rotation, int row, int col, bool clockwise) {
+	Piece* piece = &generator->orientations[rotation];
+	int new_rotation = generator->canonical_rotation[(rotation + (clockwise ? 1 : 3)) & 3];
+	Piece* rotated = &generator->orientations[new_rotation];
+	piece->row_pos = row;
+	piece->col_pos = col;
+	int new_row, new_col;
+	if (find_rotation_position(grid, piece, rotated, &new_row, &new_col)) {
+		visit(generator, queue_end, get_state(generator, new_rotation, new_row, new_col), state, clockwise ? INPUT_ROTATE_CW : INPUT_ROTATE_CCW);
+	}
+}
+
+// Breadth first from the start state. Each state tries left, right and both rotations before moving down,
+// and any state that can't move down is a placement.
+static int search_placements(MoveGenerator* generator, Grid* grid, int rotation, int row, int col) {
+	generator->placement_count = 0;
+	if (grid->width != generator->width || grid->height != generator->height) {
+		fprintf(stderr, "Error: Move generator is for %dx%d boards, not %dx%d\n", generator->width, generator->height, grid->width, grid->height);
+		return 0;
+	}
+	rotation = generator->canonical_rotation[rotation];
+	if (!validate_piece_at_position(grid, &generator->orientations[rotation], row, col)) {
+		return 0;
+	}
+
+	int queue_start = 0;
+	int queue_end = 0;
+	visit(generator, &queue_end, get_state(generator, rotation, row, col), -1, INPUT_DOWN);
+	while (queue_start < queue_end) {
+		int state = generator->queue[queue_start++];
+		decode_state(generator, state, &rotation, &row, &col);
+		Piece* piece = &generator->orientations[rotation];
+
+		if (validate_piece_at_position(grid, piece, row, col - 1)) {
+			visit(generator, &queue_end, state - 1, state, INPUT_LEFT);
+		}
+		if (validate_piece_at_position(grid, piece, row, col + 1)) {
+			visit(generator, &queue_end, state + 1, state, INPUT_RIGHT);
+		}
+		visit_rotation(generator, grid, &queue_end, state, rotation, row, col, true);
+		visit_rotation(generator, grid, &queue_end, state, rotation, row, col, false);
+		if (validate_piece_at_position(grid, piece, row + 1, col)) {
+			visit(generator, &queue_end, state + generator->width, state, INPUT_DOWN);
+		}
+		else {
+			generator->placements[generator->placement_count++] = (Placement){ row, col, rotation, state };
+		}
+	}
+
+	// Only the reached states were marked, so unmarking them is cheaper than clearing the whole bitmap on big boards
+	for (int i = 0; i < queue_end; i++) {
+		int state = generator->queue[i];
+		generator->visited[state / 64] &= ~((Uint64)1 << (state % 64));
+	}
+	generator->nodes += queue_end;
+	return generator->placement_count;
+}
+
+int generate_placements(MoveGenerator* generator, Grid* grid, enum PieceType type) {
+	set_orientations(generator, type);
+	Piece* piece = &generator->orientations[0];
+	return search_placements(generator, grid, 0, 0, grid->width / 2 - piece->width / 2);
+}
+
+int generate_placements_from(MoveGenerator* generator, Grid* grid, const Piece* piece) {
+	set_orientations(generator, piece->type);
+	return search_placements(generator, grid, piece->rotation, piece->row_pos, piece->col_pos);
+}
+
+int get_placement_path(const MoveGenerator* generator, const Placement* placement, MoveInput* path, int max_length) {
+	// Soft drops straight down to the placement are left to the hard drop
+	int last = placement->state;
+	while (generator->parents[last] >= 0 && generator->parent_inputs[last] == INPUT_DOWN) {
+		last = generator->parents[last];
+	}
+	int length = 1;
+	for (int state = last; generator->parents[state] >= 0; state = generator->parents[state]) {
+		length++;
+	}
+
+	int index = length - 1;
+	if (index < max_length) {
+		path[index] = INPUT_HARD_DROP;
+	}
+	for (int state = last; generator->parents[state] >= 0; state = generator->parents[state]) {
+		index--;
+		if (index < max_length) {
+			path[index] = (MoveInput)generator->parent_inputs[state];
+		}
+	}
+	return length;
+}
+
+// Perft plays on the grid's lock bits alone: pieces are OR'd in and full rows are squeezed out, without the cells,
+// locked piece list or gravity the game would also update. That is all the move generator looks at.
+static void lock_piece_bits(Grid* grid, const Piece* piece, int row, int col) {
+	for (int i = 0; i < piece->height; i++) {
+		Uint64* bits = grid->row_bits + (size_t)(row + i) * grid->row_words + col / 64;
+		int shift = col % 64;
+		bits[0] |= (Uint64)piece->row_masks[i] << shift;
+		if (shift > 64 - MAX_PIECE_SIZE) {
+			Uint64 spill = (Uint64)piece->row_masks[i] >> (64 - shift);
+			if (spill) {
+				bits[1] |= spill;
+			}
+		}
+	}
+}
+
+static bool is_bit_row_full(const Grid* grid, const Uint64* bits) {
+	for (int word = 0; word < grid->row_words - 1; word++) {
+		if (bits[word] != ~(Uint64)0) {
+			return false;
+		}
+	}
+	return bits[grid->row_words - 1] == grid->last_word_mask;
+}
+
+static void clear_full_bit_rows(Grid* grid) {
+	int row_words = grid->row_words;
+	int write_row = grid->height - 1;
+	for (int row = grid->height - 1; row >= 0; row--) {
+		Uint64* bits = grid->row_bits + (size_t)row * row_words;
+		if (is_bit_row_full(grid, bits)) {
+			continue;
+		}
+		if (write_row != row) {
+			memcpy(grid->row_bits + (size_t)write_row * row_words, bits, sizeof(Uint64) * row_words);
+		}
+		write_row--;
+	}
+	if (write_row >= 0) {
+		memset(grid->row_bits, 0, sizeof(Uint64) * row_words * (write_row + 1));
+	}
+}
+
+typedef struct {
+	Grid* grid;
+	MoveGenerator* generators[PERFT_MAX_DEPTH]; // One per depth so a parent's placements survive its children's searches
+	Uint64* saved_bits[PERFT_MAX_DEPTH];
+	enum PieceType sequence[PERFT_MAX_DEPTH];
+	Uint64 counts[PERFT_MAX_DEPTH]; // Placement sequences found at each depth
+	int max_depth;
+} Perft;
+
+static void run_perft(Perft* perft, int depth) {
+	Grid* grid = perft->grid;
+	MoveGenerator* generator = perft->generators[depth];
+	int count = generate_placements(generator, grid, perft->sequence[depth]);
+	perft->counts[depth] += count;
+	if (depth + 1 >= perft->max_depth) {
+		return;
+	}
+	size_t bits_size = sizeof(Uint64) * grid->row_words * grid->height;
+	memcpy(perft->saved_bits[depth], grid->row_bits, bits_size);
+	for (int i = 0; i < count; i++) {
+		Placement* placement = &generator->placements[i];
+		lock_piece_bits(grid, &generator->orientations[placement->rotation], placement->row, placement->col);
+		clear_full_bit_rows(grid);
+		run_perft(perft, depth + 1);
+		memcpy(grid->row_bits, perft->saved_bits[depth], bits_size);
+	}
+}
+
+void run_move_generator_perft(int max_depth) {
+	if (max_depth < 1 || max_depth > PERFT_MAX_DEPTH) {
+		fprintf(stderr, "Error: Perft depth must be between 1 and %d\n", PERFT_MAX_DEPTH);
+		return;
+	}
+	Perft perft = { 0 };
+	perft.max_depth = max_depth;
+	perft.grid = create_grid(BOARD_WIDTH, BOARD_HEIGHT, false, false);
+	bool created = perft.grid != NULL;
+	Random random;
+	seed_random(&random, 1); // Same pieces every run, so counts can be compared between builds
+	for (int depth = 0; depth < max_depth && created; depth++) {
+		perft.sequence[depth] = random_piece_type(&random);
+		perft.generators[depth] = create_move_generator(BOARD_WIDTH, BOARD_HEIGHT);
+		perft.saved_bits[depth] = malloc(sizeof(Uint64) * perft.grid->row_words * BOARD_HEIGHT);
+		created = perft.generators[depth] && perft.saved_bits[depth];
+	}
+
+	if (created) {
+		Uint64 start = SDL_GetPerformanceCounter();
+		run_perft(&perft, 0);
+		double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+		Uint64 placements = 0;
+		Uint64 nodes = 0;
+		printf("depth  piece        placements\n");
+		for (int depth = 0; depth < max_depth; depth++) {
+			printf("%5d  %5d  %16llu\n", depth + 1, perft.sequence[depth], (unsigned long long)perft.counts[depth]);
+			placements += perft.counts[depth];
+			nodes += perft.generators[depth]->nodes;
+		}
+		printf("%llu states searched in %.3f s\n", (unsigned long long)nodes, seconds);
+		printf("%14.0f states/sec\n", nodes / seconds);
+		printf("%14.0f placements/sec\n", placements / seconds);
+	}
+	else {
+		fprintf(stderr, "Error: Failed to set up perft\n");
+	}
+
+	for (int depth = 0; depth < max_depth; depth++) {
+		destroy_move_generator(perft.generators[depth]);
+		free(perft.saved_bits[depth]);
+	}
+	destroy_grid(perft.grid);
+}
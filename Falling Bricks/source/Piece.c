@@ -2,7 +2,88 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-static bool calloc_failed(bool* shape);
+typedef struct {
+	int width;
+	int height;
+	Uint8 row_masks[MAX_PIECE_SIZE];
+} PieceOrientation;
+
+// Every orientation of every piece, indexed by [type][rotation]. Rotation index 1 is one clockwise turn from spawn.
+// Rotating is then just picking a new entry instead of allocating and transposing a new shape.
+static const PieceOrientation piece_orientations[7][4] = {
+	// LINE
+	{
+		{ 4, 1, { 0xF, 0x0, 0x0, 0x0 } }, // 1111
+		{ 1, 4, { 0x1, 0x1, 0x1, 0x1 } }, // 1 / 1 / 1 / 1
+		{ 4, 1, { 0xF, 0x0, 0x0, 0x0 } }, // 1111
+		{ 1, 4, { 0x1, 0x1, 0x1, 0x1 } }, // 1 / 1 / 1 / 1
+	},
+	// L
+	{
+		{ 3, 2, { 0x1, 0x7, 0x0, 0x0 } }, // 100 / 111
+		{ 2, 3, { 0x3, 0x1, 0x1, 0x0 } }, // 11 / 10 / 10
+		{ 3, 2, { 0x7, 0x4, 0x0, 0x0 } }, // 111 / 001
+		{ 2, 3, { 0x2, 0x2, 0x3, 0x0 } }, // 01 / 01 / 11
+	},
+	// LR
+	{
+		{ 3, 2, { 0x4, 0x7, 0x0, 0x0 } }, // 001 / 111
+		{ 2, 3, { 0x1, 0x1, 0x3, 0x0 } }, // 10 / 10 / 11
+		{ 3, 2, { 0x7, 0x1, 0x0, 0x0 } }, // 111 / 100
+		{ 2, 3, { 0x3, 0x2, 0x2, 0x0 } }, // 11 / 01 / 01
+	},
+	// S
+	{
+		{ 2, 2, { 0x3, 0x3, 0x0, 0x0 } }, // 11 / 11
+		{ 2, 2, { 0x3, 0x3, 0x0, 0x0 } }, // 11 / 11
+		{ 2, 2, { 0x3, 0x3, 0x0, 0x0 } }, // 11 / 11
+		{ 2, 2, { 0x3, 0x3, 0x0, 0x0 } }, // 11 / 11
+	},
+	// Z
+	{
+		{ 3, 2, { 0x3, 0x6, 0x0, 0x0 } }, // 110 / 011
+		{ 2, 3, { 0x2, 0x3, 0x1, 0x0 } }, // 01 / 11 / 10
+		{ 3, 2, { 0x3, 0x6, 0x0, 0x0 } }, // 110 / 011
+		{ 2, 3, { 0x2, 0x3, 0x1, 0x0 } }, // 01 / 11 / 10
+	},
+	// ZR
+	{
+		{ 3, 2, { 0x6, 0x3, 0x0, 0x0 } }, // 011 / 110
+		{ 2, 3, { 0x1, 0x3, 0x2, 0x0 } }, // 10 / 11 / 01
+		{ 3, 2, { 0x6, 0x3, 0x0, 0x0 } }, // 011 / 110
+		{ 2, 3, { 0x1, 0x3, 0x2, 0x0 } }, // 10 / 11 / 01
+	},
+	// T
+	{
+		{ 3, 2, { 0x2, 0x7, 0x0, 0x0 } }, // 010 / 111
+		{ 2, 3, { 0x1, 0x3, 0x1, 0x0 } }, // 10 / 11 / 10
+		{ 3, 2, { 0x7, 0x2, 0x0, 0x0 } }, // 111 / 010
+		{ 2, 3, { 0x2, 0x3, 0x2, 0x0 } }, // 01 / 11 / 01
+	}
+};
+
+static const SDL_Color piece_colors[7] = {
+	{ 0, 255, 255, SDL_ALPHA_OPAQUE }, // LINE
+	{ 255, 0, 255, SDL_ALPHA_OPAQUE }, // L
+	{ 255, 255, 0, SDL_ALPHA_OPAQUE }, // LR
+	{ 0, 255, 0, SDL_ALPHA_OPAQUE },   // S
+	{ 255, 0, 0, SDL_ALPHA_OPAQUE },   // Z
+	{ 0, 0, 255, SDL_ALPHA_OPAQUE },   // ZR
+	{ 255, 113, 0, SDL_ALPHA_OPAQUE }  // T
+};
+
+bool init_piece(Piece* piece, enum PieceType type) {
+	if (type < 0 || type >= 7) {
+		fprintf(stderr, "Error: Invalid Piece Type\n");
+		return false;
+	}
+	piece->row_pos = 0;
+	piece->col_pos = 0;
+	piece->type = type;
+	piece->color = piece_colors[type];
+	set_piece_rotation(piece, 0);
+	return true;
+}
 
 Piece* create_piece(enum PieceType type) {
 	Piece* piece = malloc(sizeof(Piece));
@@ -10,140 +91,53 @@ Piece* create_piece(enum PieceType type) {
 		fprintf(stderr, "Error: Failed to allocate memory for Piece\n");
 		return NULL;
 	}
-	SDL_assert(type >= 0 && type < 7);
-	piece->row_pos = 0;
-	piece->col_pos = 0;
-	piece->type = type;
-	switch (type) {
-	case LINE:
-		// 1 1 1 1
-		piece->width = 4;
-		piece->height = 1;
-		piece->shape = calloc(piece->height * piece->width, sizeof(bool));
-		if (calloc_failed(piece->shape)) { free(piece); return NULL; }
-		piece->shape[0] = true;
-		piece->shape[1] = true;
-		piece->shape[2] = true;
-		piece->shape[3] = true;
-		piece->color = (SDL_Color){ 0, 255, 255, SDL_ALPHA_OPAQUE };
-		break;
-	case L:
-		// 1 0 0
-		// 1 1 1
-		piece->width = 3;
-		piece->height = 2;
-		piece->shape = calloc(piece->height * piece->width, sizeof(bool));
-		if (calloc_failed(piece->shape)) { free(piece); return NULL; }
-		piece->shape[0] = true;
-		piece->shape[3] = true;
-		piece->shape[4] = true;
-		piece->shape[5] = true;
-		piece->color = (SDL_Color){ 255, 0, 255, SDL_ALPHA_OPAQUE };
-		break;
-	case LR:
-		// 0 0 1
-		// 1 1 1
-		piece->width = 3;
-		piece->height = 2;
-		piece->shape = calloc(piece->height * piece->width, sizeof(bool));
-		if (calloc_failed(piece->shape)) { free(piece); return NULL; }
-		piece->shape[2] = true;
-		piece->shape[3] = true;
-		piece->shape[4] = true;
-		piece->shape[5] = true;
-		piece->color = (SDL_Color){ 255, 255, 0, SDL_ALPHA_OPAQUE };
-		break;
-	case S:
-		// 1 1
-		// 1 1
-		piece->width = 2;
-		piece->height = 2;
-		piece->shape = calloc(piece->height * piece->width, sizeof(bool));
-		if (calloc_failed(piece->shape)) { free(piece); return NULL; }
-		piece->shape[0] = true;
-		piece->shape[1] = true;
-		piece->shape[2] = true;
-		piece->shape[3] = true;
-		piece->color = (SDL_Color){ 0, 255, 0, SDL_ALPHA_OPAQUE };
-		break;
-	case Z:
-		// 1 1 0
-		// 0 1 1
-		piece->width = 3;
-		piece->height = 2;
-		piece->shape = calloc(piece->height * piece->width, sizeof(bool));
-		if (calloc_failed(piece->shape)) { free(piece); return NULL; }
-		piece->shape[0] = true;
-		piece->shape[1] = true;
-		piece->shape[4] = true;
-		piece->shape[5] = true;
-		piece->color = (SDL_Color){ 255, 0, 0, SDL_ALPHA_OPAQUE };
-		break;
-	case ZR:
-		// 0 1 1
-		// 1 1 0
-		piece->width = 3;
-		piece->height = 2;
-		piece->shape = calloc(piece->height * piece->width, sizeof(bool));
-		if (calloc_failed(piece->shape)) { free(piece); return NULL; }
-		piece->shape[1] = true;
-		piece->shape[2] = true;
-		piece->shape[3] = true;
-		piece->shape[4] = true;
-		piece->color = (SDL_Color){ 0, 0, 255, SDL_ALPHA_OPAQUE };
-		break;
-	case T:
-		// 0 1 0
-		// 1 1 1
-		piece->width = 3;
-		piece->height = 2;
-		piece->shape = calloc(piece->height * piece->width, sizeof(bool));
-		if (calloc_failed(piece->shape)) { free(piece); return NULL; }
-		piece->shape[1] = true;
-		piece->shape[3] = true;
-		piece->shape[4] = true;
-		piece->shape[5] = true;
-		piece->color = (SDL_Color){ 255, 113, 0, SDL_ALPHA_OPAQUE };
-		break;
-	default:
-		fprintf(stderr, "Error: Invalid Piece Type\n");
+	if (!init_piece(piece, type)) {
 		free(piece);
 		return NULL;
 	}
 	return piece;
 }
 
-Piece* create_random_piece() {
-	int random_piece = rand() % 7;
-	return create_piece(random_piece);
+enum PieceType random_piece_type(Random* random) {
+	return random_int(random, PIECE_TYPE_COUNT);
 }
 
-Piece* rotate_piece(const Piece* piece, bool clockwise) {
-	Piece* rotated_piece = malloc(sizeof(Piece));
+Piece* create_random_piece(Random* random) {
+	return create_piece(random_piece_type(random));
+}
 
-	if (!rotated_piece) {
-		fprintf(stderr, "Error: Failed to allocate memory for rotated Piece\n");
-		return NULL;
+void set_piece_rotation(Piece* piece, int rotation) {
+	const PieceOrientation* orientation = &piece_orientations[piece->type][rotation];
+	piece->rotation = rotation;
+	piece->width = orientation->width;
+	piece->height = orientation->height;
+	for (int i = 0; i < MAX_PIECE_SIZE; i++) {
+		piece->row_masks[i] = orientation->row_masks[i];
 	}
-
-	int new_width = piece->height;
-	int new_height = piece->width;
-	rotated_piece->width = new_width;
-	rotated_piece->height = new_height;
-	rotated_piece->color = piece->color;
-	rotated_piece->shape = calloc(new_width * new_height, sizeof(bool));
-	if (calloc_failed(rotated_piece->shape)) { free(piece); return NULL; }
-
-	for (int i = 0; i < new_width; i++) {
-		for (int j = 0; j < new_height; j++) {
-			int col = clockwise ? new_width - 1 - i : i; // clockwise or counter-clockwise. In other words, start from the last col or first col
-			int row = clockwise ? j : new_height - 1 - j; // clockwise or counter-clockwise. In other words, start from the first row or last row
-			rotated_piece->shape[row * new_width + col] = piece->shape[i * piece->width + j];
-			// shape[j][new_width - 1 - i] = piece->shape[i][j];
+	for (int i = 0; i < piece->height; i++) {
+		for (int j = 0; j < piece->width; j++) {
+			piece->shape[i * piece->width + j] = (orientation->row_masks[i] >> j) & 1;
 		}
 	}
+}
+
+void rotate_piece(Piece* piece, bool clockwise) {
+	set_piece_rotation(piece, (piece->rotation + (clockwise ? 1 : 3)) & 3);
+}
 
-	return rotated_piece;
+void update_piece_row_masks(Piece* piece) {
+	SDL_assert(piece->height <= MAX_PIECE_SIZE && piece->width <= MAX_PIECE_SIZE);
+	for (int i = 0; i < MAX_PIECE_SIZE; i++) {
+		Uint8 mask = 0;
+		if (i < piece->height) {
+			for (int j = 0; j < piece->width; j++) {
+				if (piece->shape[i * piece->width + j]) {
+					mask |= 1 << j;
+				}
+			}
+		}
+		piece->row_masks[i] = mask;
+	}
 }
 
 bool is_piece_empty(const Piece* piece) {
@@ -161,57 +155,37 @@ Piece* copy_piece(const Piece* piece) {
 		fprintf(stderr, "Error: Failed to allocate memory for copied Piece\n");
 		return NULL;
 	}
-	new_piece->width = piece->width;
-	new_piece->height = piece->height;
-	new_piece->row_pos = piece->row_pos;
-	new_piece->col_pos = piece->col_pos;
-	new_piece->type = piece->type;
-	new_piece->color = piece->color;
-	new_piece->shape = calloc(new_piece->height * new_piece->width, sizeof(bool));
-	if (calloc_failed(new_piece->shape)) { free(new_piece); return NULL; }
-	for (int i = 0; i < new_piece->height * new_piece->width; i++) {
-		new_piece->shape[i] = piece->shape[i];
-	}
+	*new_piece = *piece; // Shape is stored inline so a plain struct copy is a deep copy
 	return new_piece;
 }
 
-Piece* copy_piece_region(Piece* original, int start_row, int start_col, int new_height, int new_width) {
-	Piece* new_piece = malloc(sizeof(Piece));
-	if (!new_piece) {
-		fprintf(stderr, "Error: Failed to allocate memory for copied Piece region\n");
-		return NULL;
-	}
+void init_piece_region(Piece* new_piece, const Piece* original, int start_row, int start_col, int new_height, int new_width) {
 	new_piece->width = new_width;
 	new_piece->height = new_height;
 	new_piece->color = original->color;
 	new_piece->type = original->type;
+	new_piece->rotation = original->rotation;
 	new_piece->row_pos = 0;
 	new_piece->col_pos = 0;
-	new_piece->shape = calloc(new_width * new_height, sizeof(bool));
-	if (calloc_failed(new_piece->shape)) { free(new_piece); return NULL; }
 
 	for (int i = 0; i < new_height; i++) {
 		for (int j = 0; j < new_width; j++) {
 			new_piece->shape[i * new_width + j] = original->shape[(i + start_row) * original->width + (j + start_col)];
 		}
 	}
-
-	return new_piece;
+	update_piece_row_masks(new_piece);
 }
 
-void destroy_piece(Piece* piece) {
-	if (piece) {
-		free(piece->shape);
-		free(piece);
+Piece* copy_piece_region(const Piece* original, int start_row, int start_col, int new_height, int new_width) {
+	Piece* new_piece = malloc(sizeof(Piece));
+	if (!new_piece) {
+		fprintf(stderr, "Error: Failed to allocate memory for copied Piece region\n");
+		return NULL;
 	}
+	init_piece_region(new_piece, original, start_row, start_col, new_height, new_width);
+	return new_piece;
 }
 
-static bool calloc_failed(bool* shape)
-{
-	if (!shape)
-	{
-		fprintf(stderr, "Error: Failed to allocate memory for Piece Shape\n");
-		return true;
-	}
-	return false;
+void destroy_piece(Piece* piece) {
+	free(piece);
 }
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "PiecePool.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+PiecePool* create_piece_pool(int capacity) {
+	if (capacity <= 0) {
+		fprintf(stderr, "Error: Piece pool capacity must be greater than 0\n");
+		return NULL;
+	}
+	PiecePool* pool = malloc(sizeof(PiecePool));
+	if (!pool) {
+		fprintf(stderr, "Error: Failed to allocate memory for PiecePool\n");
+		return NULL;
+	}
+	pool->pieces = malloc(sizeof(Piece) * capacity);
+	pool->free_indices = malloc(sizeof(int) * capacity);
+	if (!pool->pieces || !pool->free_indices) {
+		fprintf(stderr, "Error: Failed to allocate memory for PiecePool storage\n");
+		free(pool->pieces);
+		free(pool->free_indices);
+		free(pool);
+		return NULL;
+	}
+	pool->capacity = capacity;
+	pool->high_water_mark = 0;
+	pool->failed_acquires = 0;
+	reset_piece_pool(pool);
+	return pool;
+}
+
+Piece* acquire_piece(PiecePool* pool) {
+	if (pool->free_count == 0) {
+		pool->failed_acquires++;
+		fprintf(stderr, "Error: Piece pool exhausted (capacity %d)\n", pool->capacity);
+		return NULL;
+	}
+	Piece* piece = &pool->pieces[pool->free_indices[--pool->free_count]];
+	int in_use = pool->capacity - pool->free_count;
+	if (in_use > pool->high_water_mark) {
+		pool->high_water_mark = in_use;
+	}
+	return piece;
+}
+
+Piece* acquire_new_piece(PiecePool* pool, enum PieceType type) {
+	Piece* piece = acquire_piece(pool);
+	if (piece && !init_piece(piece, type)) {
+		release_piece(pool, piece);
+		return NULL;
+	}
+	return piece;
+}
+
+Piece* acquire_piece_copy(PiecePool* pool, const Piece* piece) {
+	Piece* new_piece = acquire_piece(pool);
+	if (new_piece) {
+		*new_piece = *piece;
+	}
+	return new_piece;
+}
+
+void release_piece(PiecePool* pool, Piece* piece) {
+	if (!piece) return;
+	SDL_assert(piece >= pool->pieces && piece < pool->pieces + pool->capacity);
+	SDL_assert(pool->free_count < pool->capacity);
+	pool->free_indices[pool->free_count++] = (int)(piece - pool->pieces);
+}
+
+int pieces_in_use(const PiecePool* pool) {
+	return pool->capacity - pool->free_count;
+}
+
+void reset_piece_pool(PiecePool* pool) {
+	// Hand out low slots first so pieces in use stay packed near the start of the block
+	for (int i = 0; i < pool->capacity; i++) {
+		pool->free_indices[i] = pool->capacity - 1 - i;
+	}
+	pool->free_count = pool->capacity;
+}
+
+void print_piece_pool_stats(const PiecePool* pool, const char* label) {
+	printf("%s piece pool: %d/%d in use, high water mark %d, failed acquires %d\n",
+		label, pieces_in_use(pool), pool->capacity, pool->high_water_mark, pool->failed_acquires);
+}
+
+void destroy_piece_pool(PiecePool* pool) {
+	if (pool) {
+		free(pool->pieces);
+		free(pool->free_indices);
+		free(pool);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#include "PieceQueue.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+PieceQueue* create_piece_queue(int length, Uint64 seed) {
+	if (length <= 0) {
+		fprintf(stderr, "Error: Piece queue length must be greater than 0\n");
+		return NULL;
+	}
+	PieceQueue* queue = malloc(sizeof(PieceQueue));
+	if (!queue) {
+		fprintf(stderr, "Error: Failed to allocate memory for PieceQueue\n");
+		return NULL;
+	}
+	queue->types = malloc(sizeof(enum PieceType) * length);
+	if (!queue->types) {
+		fprintf(stderr, "Error: Failed to allocate memory for piece queue types\n");
+		free(queue);
+		return NULL;
+	}
+	queue->length = length;
+	seed_piece_queue(queue, seed, RANDOMIZER_UNIFORM);
+	return queue;
+}
+
+void seed_piece_queue(PieceQueue* queue, Uint64 seed, PieceRandomizer randomizer) {
+	seed_random(&queue->random, seed);
+	queue->randomizer = randomizer;
+	fill_piece_queue(queue);
+}
+
+// Fisher-Yates shuffle of a full bag
+static void refill_bag(PieceQueue* queue) {
+	for (int i = 0; i < PIECE_TYPE_COUNT; i++) {
+		queue->bag[i] = i;
+	}
+	for (int i = PIECE_TYPE_COUNT - 1; i > 0; i--) {
+		int j = random_int(&queue->random, i + 1);
+		enum PieceType type = queue->bag[i];
+		queue->bag[i] = queue->bag[j];
+		queue->bag[j] = type;
+	}
+	queue->bag_count = PIECE_TYPE_COUNT;
+}
+
+static enum PieceType random_queue_type(PieceQueue* queue) {
+	if (queue->randomizer == RANDOMIZER_UNIFORM) {
+		return random_piece_type(&queue->random);
+	}
+	if (queue->bag_count == 0) {
+		refill_bag(queue);
+	}
+	return queue->bag[--queue->bag_count];
+}
+
+void fill_piece_queue(PieceQueue* queue) {
+	queue->front = 0;
+	queue->bag_count = 0;
+	for (int i = 0; i < queue->length; i++) {
+		queue->types[i] = random_queue_type(queue);
+	}
+}
+
+enum PieceType next_piece_type(PieceQueue* queue) {
+	enum PieceType type = queue->types[queue->front];
+	queue->types[queue->front] = random_queue_type(queue); // The freed slot is now the back of the queue
+	queue->front = (queue->front + 1) % queue->length;
+	return type;
+}
+
+enum PieceType peek_piece_type(const PieceQueue* queue, int index) {
+	return queue->types[(queue->front + index) % queue->length];
+}
+
+void destroy_piece_queue(PieceQueue* queue) {
+	if (!queue) return;
+	free(queue->types);
+	free(queue);
+}
\ No newline at end of file
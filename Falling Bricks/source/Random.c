@@ -0,0 +1,38 @@
+#include "Random.h"
+
+static Uint64 rotate_left(Uint64 bits, int count) {
+	return (bits << count) | (bits >> (64 - count));
+}
+
+// Spreads the seed over the whole state with splitmix64, so nearby seeds give unrelated sequences and the state is never all zero
+void seed_random(Random* random, Uint64 seed) {
+	for (int i = 0; i < 4; i++) {
+		seed += 0x9E3779B97F4A7C15ULL;
+		Uint64 mixed = seed;
+		mixed = (mixed ^ (mixed >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		mixed = (mixed ^ (mixed >> 27)) * 0x94D049BB133111EBULL;
+		random->state[i] = mixed ^ (mixed >> 31);
+	}
+}
+
+Uint64 next_random(Random* random) {
+	Uint64* s = random->state;
+	Uint64 result = rotate_left(s[1] * 5, 7) * 9;
+	Uint64 t = s[1] << 17;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotate_left(s[3], 45);
+	return result;
+}
+
+// Scales the top 32 bits instead of using %, which is faster and has no bias worth caring about for bounds this small
+int random_int(Random* random, int bound) {
+	return (int)(((next_random(random) >> 32) * (Uint64)bound) >> 32);
+}
+
+float random_float(Random* random) {
+	return (next_random(random) >> 40) * (1.0f / 16777216.0f); // 24 bits, all a float can hold
+}
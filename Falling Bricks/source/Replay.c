@@ -0,0 +1,430 @@
+#include "Replay.h"
+#include "Constants.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REPLAY_MAGIC "FBRP"
+#define REPLAY_MAGIC_LENGTH 4
+#define REPLAY_INITIAL_CAPACITY 4096
+#define MAX_VARINT_BYTES 10
+
+#define RECORD_END 0
+#define RECORD_DT 2
+#define RECORD_PAUSE 6
+
+typedef struct ReplayWriterJob {
+	struct ReplayWriterJob* next;
+	char* path;
+	Uint8* data;
+	size_t size;
+	bool truncate;
+} ReplayWriterJob;
+
+static Uint8 get_input_bits(const GameInputs* inputs) {
+	Uint8 bits = 0;
+	bits |= inputs->move_down ? REPLAY_INPUT_DOWN : 0;
+	bits |= inputs->move_left ? REPLAY_INPUT_LEFT : 0;
+	bits |= inputs->move_right ? REPLAY_INPUT_RIGHT : 0;
+	bits |= inputs->rotate ? REPLAY_INPUT_ROTATE : 0;
+	bits |= inputs->clockwise ? REPLAY_INPUT_CLOCKWISE : 0;
+	bits |= inputs->hard_drop ? REPLAY_INPUT_HARD_DROP : 0;
+	bits |= inputs->shift_left ? REPLAY_INPUT_SHIFT_LEFT : 0;
+	bits |= inputs->shift_right ? REPLAY_INPUT_SHIFT_RIGHT : 0;
+	return bits;
+}
+
+static GameInputs get_bit_inputs(Uint64 bits) {
+	return (GameInputs) {
+		.move_down = bits & REPLAY_INPUT_DOWN,
+		.move_left = bits & REPLAY_INPUT_LEFT,
+		.move_right = bits & REPLAY_INPUT_RIGHT,
+		.rotate = bits & REPLAY_INPUT_ROTATE,
+		.clockwise = bits & REPLAY_INPUT_CLOCKWISE,
+		.hard_drop = bits & REPLAY_INPUT_HARD_DROP,
+		.shift_left = bits & REPLAY_INPUT_SHIFT_LEFT,
+		.shift_right = bits & REPLAY_INPUT_SHIFT_RIGHT
+	};
+}
+
+// Small changes either way become small numbers: 0, -1, 1, -2... map to 0, 1, 2, 3...
+static Uint64 zigzag_encode(Sint64 value) {
+	return ((Uint64)value << 1) ^ (Uint64)(value >> 63);
+}
+
+static Sint64 zigzag_decode(Uint64 value) {
+	return (Sint64)(value >> 1) ^ -(Sint64)(value & 1);
+}
+
+static bool reserve_replay_bytes(ReplayRecorder* recorder, size_t count) {
+	if (recorder->failed) {
+		return false;
+	}
+	if (recorder->size + count <= recorder->capacity) {
+		return true;
+	}
+	size_t capacity = recorder->capacity * 2;
+	while (capacity < recorder->size + count) {
+		capacity *= 2;
+	}
+	Uint8* data = realloc(recorder->data, capacity);
+	if (!data) {
+		fprintf(stderr, "Error: Failed to grow replay to %zu bytes, recording stopped\n", capacity);
+		recorder->failed = true;
+		return false;
+	}
+	recorder->data = data;
+	recorder->capacity = capacity;
+	return true;
+}
+
+static void write_varint(ReplayRecorder* recorder, Uint64 value) {
+	if (!reserve_replay_bytes(recorder, MAX_VARINT_BYTES)) {
+		return;
+	}
+	while (value >= 0x80) {
+		recorder->data[recorder->size++] = (Uint8)(value | 0x80);
+		value >>= 7;
+	}
+	recorder->data[recorder->size++] = (Uint8)value;
+}
+
+static void write_idle_steps(ReplayRecorder* recorder) {
+	if (recorder->idle_steps) {
+		write_varint(recorder, (Uint64)recorder->idle_steps << 2);
+		recorder->idle_steps = 0;
+	}
+}
+
+ReplayRecorder* create_replay_recorder() {
+	ReplayRecorder* recorder = calloc(1, sizeof(ReplayRecorder));
+	if (!recorder) {
+		fprintf(stderr, "Error: Failed to allocate memory for ReplayRecorder\n");
+		return NULL;
+	}
+	recorder->data = malloc(REPLAY_INITIAL_CAPACITY);
+	if (!recorder->data) {
+		fprintf(stderr, "Error: Failed to allocate replay buffer\n");
+		free(recorder);
+		return NULL;
+	}
+	recorder->capacity = REPLAY_INITIAL_CAPACITY;
+	return recorder;
+}
+
+void begin_replay(ReplayRecorder* recorder, const ReplayHeader* header) {
+	recorder->size = 0;
+	recorder->flushed = 0;
+	recorder->dt = 0;
+	recorder->idle_steps = 0;
+	recorder->failed = false;
+	recorder->recording = true;
+	if (!reserve_replay_bytes(recorder, REPLAY_MAGIC_LENGTH + 1)) {
+		return;
+	}
+	memcpy(recorder->data, REPLAY_MAGIC, REPLAY_MAGIC_LENGTH);
+	recorder->data[REPLAY_MAGIC_LENGTH] = REPLAY_VERSION;
+	recorder->size = REPLAY_MAGIC_LENGTH + 1;
+	write_varint(recorder, header->seed);
+	write_varint(recorder, header->randomizer);
+	write_varint(recorder, header->mode);
+	write_varint(recorder, header->board_width);
+	write_varint(recorder, header->board_height);
+}
+
+void record_replay_step(ReplayRecorder* recorder, const GameInputs* inputs, Uint32 dt) {
+	if (!recorder->recording) {
+		return;
+	}
+	if (dt != recorder->dt) {
+		write_idle_steps(recorder);
+		write_varint(recorder, zigzag_encode((Sint64)dt - recorder->dt) << 3 | RECORD_DT);
+		recorder->dt = dt;
+	}
+	Uint8 bits = inputs ? get_input_bits(inputs) : 0;
+	if (!bits) {
+		recorder->idle_steps++;
+		return;
+	}
+	write_idle_steps(recorder);
+	write_varint(recorder, (Uint64)bits << 1 | 1);
+}
+
+void record_replay_pause(ReplayRecorder* recorder) {
+	if (!recorder->recording) {
+		return;
+	}
+	write_idle_steps(recorder);
+	write_varint(recorder, RECORD_PAUSE);
+}
+
+void end_replay(ReplayRecorder* recorder, const GameCore* game) {
+	if (!recorder->recording) {
+		return;
+	}
+	write_idle_steps(recorder);
+	write_varint(recorder, RECORD_END);
+	write_varint(recorder, game->score);
+	write_varint(recorder, game->total_lines_cleared);
+	write_varint(recorder, game->elapsed_time);
+	recorder->recording = false;
+}
+
+size_t take_replay_chunk(ReplayRecorder* recorder, const Uint8** data) {
+	*data = recorder->data + recorder->flushed;
+	size_t size = recorder->size - recorder->flushed;
+	recorder->flushed = recorder->size;
+	return size;
+}
+
+void destroy_replay_recorder(ReplayRecorder* recorder) {
+	if (!recorder) return;
+	free(recorder->data);
+	free(recorder);
+}
+
+static bool read_varint(ReplayPlayer* player, Uint64* value) {
+	*value = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		if (player->position >= player->size) {
+			return false;
+		}
+		Uint8 byte = player->data[player->position++];
+		*value |= (Uint64)(byte & 0x7F) << shift;
+		if (!(byte & 0x80)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool open_replay(ReplayPlayer* player, const Uint8* data, size_t size) {
+	*player = (ReplayPlayer){ .data = data, .size = size };
+	if (size < REPLAY_MAGIC_LENGTH + 1 || memcmp(data, REPLAY_MAGIC, REPLAY_MAGIC_LENGTH) != 0) {
+		fprintf(stderr, "Error: Not a replay\n");
+		return false;
+	}
+	if (data[REPLAY_MAGIC_LENGTH] < 1 || data[REPLAY_MAGIC_LENGTH] > REPLAY_VERSION) {
+		fprintf(stderr, "Error: Replay version %d is not supported\n", data[REPLAY_MAGIC_LENGTH]);
+		return false;
+	}
+	player->position = REPLAY_MAGIC_LENGTH + 1;
+	Uint64 seed, randomizer, mode, width, height;
+	if (!read_varint(player, &seed) || !read_varint(player, &randomizer) || !read_varint(player, &mode)
+		|| !read_varint(player, &width) || !read_varint(player, &height)) {
+		fprintf(stderr, "Error: Replay header is cut short\n");
+		return false;
+	}
+	if (randomizer > RANDOMIZER_BAG || mode > ENDLESS) {
+		fprintf(stderr, "Error: Replay header is invalid\n");
+		return false;
+	}
+	// The same sizes the game itself can be started with, so a crafted header can't ask for a board too big to index
+	if (width < MIN_BOARD_WIDTH || width > MAX_BOARD_WIDTH || height < MIN_BOARD_HEIGHT || height > MAX_BOARD_HEIGHT) {
+		fprintf(stderr, "Error: Replay board size must be between %dx%d and %dx%d\n", MIN_BOARD_WIDTH, MIN_BOARD_HEIGHT, MAX_BOARD_WIDTH, MAX_BOARD_HEIGHT);
+		return false;
+	}
+	player->header = (ReplayHeader){
+		.seed = seed,
+		.randomizer = (PieceRandomizer)randomizer,
+		.mode = (GameMode)mode,
+		.board_width = (int)width,
+		.board_height = (int)height
+	};
+	return true;
+}
+
+ReplayRecord read_replay_record(ReplayPlayer* player, GameInputs* inputs, Uint32* dt) {
+	while (true) {
+		if (player->idle_steps) {
+			player->idle_steps--;
+			player->steps++;
+			*inputs = (GameInputs){ 0 };
+			*dt = player->dt;
+			return REPLAY_STEP;
+		}
+		Uint64 code;
+		if (!read_varint(player, &code)) {
+			return REPLAY_ERROR;
+		}
+		if (code & 1) {
+			player->steps++;
+			*inputs = get_bit_inputs(code >> 1);
+			*dt = player->dt;
+			return REPLAY_STEP;
+		}
+		if ((code & 3) == 0) {
+			if (code == RECORD_END) {
+				Uint64 score, lines, elapsed;
+				if (!read_varint(player, &score) || !read_varint(player, &lines) || !read_varint(player, &elapsed)) {
+					return REPLAY_ERROR;
+				}
+				player->result = (ReplayResult){ (int)score, (int)lines, (Uint32)elapsed };
+				return REPLAY_END;
+			}
+			if ((code >> 2) > SDL_MAX_UINT32) {
+				return REPLAY_ERROR;
+			}
+			player->idle_steps = (Uint32)(code >> 2);
+			continue;
+		}
+		if ((code & 7) == RECORD_DT) {
+			player->dt += (Uint32)zigzag_decode(code >> 3);
+			continue;
+		}
+		if (code == RECORD_PAUSE) {
+			return REPLAY_PAUSE;
+		}
+		return REPLAY_ERROR;
+	}
+}
+
+Uint8* load_replay_file(const char* path, size_t* size) {
+	FILE* file = fopen(path, "rb");
+	if (!file) {
+		fprintf(stderr, "Error: Failed to open replay %s\n", path);
+		return NULL;
+	}
+	size_t capacity = REPLAY_INITIAL_CAPACITY;
+	Uint8* data = malloc(capacity);
+	*size = 0;
+	while (data) {
+		*size += fread(data + *size, 1, capacity - *size, file);
+		if (*size < capacity) {
+			break;
+		}
+		capacity *= 2;
+		Uint8* grown = realloc(data, capacity);
+		if (!grown) {
+			free(data);
+		}
+		data = grown;
+	}
+	if (!data) {
+		fprintf(stderr, "Error: Failed to allocate memory for replay %s\n", path);
+	}
+	else if (ferror(file)) {
+		fprintf(stderr, "Error: Failed to read replay %s\n", path);
+		free(data);
+		data = NULL;
+	}
+	fclose(file);
+	return data;
+}
+
+static void write_replay_job(ReplayWriterJob* job) {
+	FILE* file = fopen(job->path, job->truncate ? "wb" : "ab");
+	if (!file) {
+		fprintf(stderr, "Error: Failed to open %s to write the replay\n", job->path);
+		return;
+	}
+	if (fwrite(job->data, 1, job->size, file) != job->size) {
+		fprintf(stderr, "Error: Failed to write replay %s\n", job->path);
+	}
+	fclose(file);
+}
+
+static void free_replay_job(ReplayWriterJob* job) {
+	free(job->path);
+	free(job->data);
+	free(job);
+}
+
+static int replay_writer_thread(void* data) {
+	ReplayWriter* writer = data;
+	SDL_LockMutex(writer->lock);
+	while (true) {
+		ReplayWriterJob* job = writer->first_job;
+		if (!job) {
+			if (writer->quit) {
+				break;
+			}
+			SDL_CondWait(writer->wake, writer->lock);
+			continue;
+		}
+		writer->first_job = job->next;
+		if (!writer->first_job) {
+			writer->last_job = NULL;
+		}
+		// The disk is only touched with the lock released, so queueing never waits on it
+		SDL_UnlockMutex(writer->lock);
+		write_replay_job(job);
+		free_replay_job(job);
+		SDL_LockMutex(writer->lock);
+	}
+	SDL_UnlockMutex(writer->lock);
+	return 0;
+}
+
+ReplayWriter* create_replay_writer() {
+	ReplayWriter* writer = calloc(1, sizeof(ReplayWriter));
+	if (!writer) {
+		fprintf(stderr, "Error: Failed to allocate memory for ReplayWriter\n");
+		return NULL;
+	}
+	writer->lock = SDL_CreateMutex();
+	writer->wake = SDL_CreateCond();
+	if (writer->lock && writer->wake) {
+		writer->thread = SDL_CreateThread(replay_writer_thread, "ReplayWriter", writer);
+	}
+	if (!writer->thread) {
+		fprintf(stderr, "Error: Failed to start the replay writer thread, replays will be written as they are queued\n");
+	}
+	return writer;
+}
+
+bool queue_replay_write(ReplayWriter* writer, const char* path, const Uint8* data, size_t size, bool truncate) {
+	ReplayWriterJob* job = malloc(sizeof(ReplayWriterJob));
+	size_t path_length = strlen(path) + 1;
+	if (job) {
+		job->path = malloc(path_length);
+		job->data = malloc(size ? size : 1);
+	}
+	if (!job || !job->path || !job->data) {
+		fprintf(stderr, "Error: Failed to allocate memory for replay write\n");
+		if (job) {
+			free_replay_job(job);
+		}
+		return false;
+	}
+	memcpy(job->path, path, path_length);
+	memcpy(job->data, data, size);
+	job->size = size;
+	job->truncate = truncate;
+	job->next = NULL;
+
+	if (!writer->thread) {
+		write_replay_job(job);
+		free_replay_job(job);
+		return true;
+	}
+	SDL_LockMutex(writer->lock);
+	if (writer->last_job) {
+		writer->last_job->next = job;
+	}
+	else {
+		writer->first_job = job;
+	}
+	writer->last_job = job;
+	SDL_CondSignal(writer->wake);
+	SDL_UnlockMutex(writer->lock);
+	return true;
+}
+
+void destroy_replay_writer(ReplayWriter* writer) {
+	if (!writer) return;
+	if (writer->thread) {
+		SDL_LockMutex(writer->lock);
+		writer->quit = true;
+		SDL_CondSignal(writer->wake);
+		SDL_UnlockMutex(writer->lock);
+		SDL_WaitThread(writer->thread, NULL);
+	}
+	if (writer->wake) {
+		SDL_DestroyCond(writer->wake);
+	}
+	if (writer->lock) {
+		SDL_DestroyMutex(writer->lock);
+	}
+	free(writer);
+}
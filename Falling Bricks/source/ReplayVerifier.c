@@ -0,0 +1,262 @@
+#include "ReplayVerifier.h"
+#include "Constants.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// One worker's share of the replays, [next, end). The owner takes from the front and thieves from the back.
+typedef struct {
+	SDL_SpinLock lock;
+	int next;
+	int end;
+} VerifyQueue;
+
+typedef struct {
+	SDL_Thread* thread; // NULL for the first worker, which is the calling thread
+	VerifyQueue queue;
+	int index;
+} VerifyWorker;
+
+typedef struct {
+	const char* const* paths;
+	ReplayCheck* checks;
+	VerifyWorker* workers;
+	int worker_count;
+} VerifyJob;
+
+typedef struct {
+	VerifyJob* job;
+	VerifyWorker* worker;
+} VerifyThreadData;
+
+static const char* get_verdict_name(ReplayVerdict verdict) {
+	switch (verdict) {
+	case VERIFY_MATCH: return "match";
+	case VERIFY_MISMATCH: return "mismatch";
+	default: return "invalid";
+	}
+}
+
+static bool results_match(const ReplayResult* a, const ReplayResult* b) {
+	return a->score == b->score && a->total_lines_cleared == b->total_lines_cleared && a->elapsed_time == b->elapsed_time;
+}
+
+void verify_replay(const Uint8* data, size_t size, ReplayCheck* check) {
+	check->verdict = VERIFY_INVALID;
+	check->claimed = check->simulated = (ReplayResult){ 0 };
+	check->steps = 0;
+	ReplayPlayer player;
+	GameCore game;
+	if (!open_replay(&player, data, size)) {
+		return;
+	}
+	const ReplayHeader* header = &player.header;
+	if (!init_game_core(&game, header->board_width, header->board_height, header->seed)) {
+		return;
+	}
+	seed_game_core(&game, header->seed, header->randomizer);
+	start_game_mode(&game, header->mode);
+
+	ReplayRecord record;
+	GameInputs inputs;
+	Uint32 dt;
+	while ((record = read_replay_record(&player, &inputs, &dt)) != REPLAY_END && record != REPLAY_ERROR) {
+		if (player.steps > VERIFY_MAX_STEPS) {
+			record = REPLAY_ERROR;
+			break;
+		}
+		if (record == REPLAY_PAUSE) {
+			toggle_game_pause(&game);
+		}
+		else {
+			game_step(&game, &inputs, dt);
+		}
+	}
+	check->steps = player.steps;
+	check->simulated = (ReplayResult){ game.score, game.total_lines_cleared, game.elapsed_time };
+	if (record == REPLAY_END) {
+		check->claimed = player.result;
+		check->verdict = results_match(&check->claimed, &check->simulated) ? VERIFY_MATCH : VERIFY_MISMATCH;
+	}
+	free_game_core(&game);
+}
+
+static void verify_replay_file(const char* path, ReplayCheck* check) {
+	size_t size;
+	Uint8* data = load_replay_file(path, &size);
+	if (data) {
+		verify_replay(data, size, check);
+		free(data);
+	}
+	else {
+		*check = (ReplayCheck){ .verdict = VERIFY_INVALID };
+	}
+	check->path = path;
+}
+
+static bool take_own_replay(VerifyQueue* queue, int* index) {
+	SDL_AtomicLock(&queue->lock);
+	bool found = queue->next < queue->end;
+	if (found) {
+		*index = queue->next++;
+	}
+	SDL_AtomicUnlock(&queue->lock);
+	return found;
+}
+
+// Takes the back half of the first other worker with replays left, keeping one to run now and queueing the rest
+static bool steal_replays(VerifyJob* job, VerifyWorker* thief, int* index) {
+	for (int i = 1; i < job->worker_count; i++) {
+		VerifyQueue* victim = &job->workers[(thief->index + i) % job->worker_count].queue;
+		SDL_AtomicLock(&victim->lock);
+		int remaining = victim->end - victim->next;
+		int first = victim->end - (remaining + 1) / 2;
+		int end = victim->end;
+		if (remaining > 0) {
+			victim->end = first;
+		}
+		SDL_AtomicUnlock(&victim->lock);
+		if (remaining <= 0) {
+			continue;
+		}
+		*index = first;
+		SDL_AtomicLock(&thief->queue.lock);
+		thief->queue.next = first + 1;
+		thief->queue.end = end;
+		SDL_AtomicUnlock(&thief->queue.lock);
+		return true;
+	}
+	return false;
+}
+
+static void verify_worker_replays(VerifyJob* job, VerifyWorker* worker) {
+	int index;
+	while (take_own_replay(&worker->queue, &index) || steal_replays(job, worker, &index)) {
+		verify_replay_file(job->paths[index], &job->checks[index]);
+	}
+}
+
+static int verify_worker_thread(void* data) {
+	VerifyThreadData* thread_data = data;
+	verify_worker_replays(thread_data->job, thread_data->worker);
+	return 0;
+}
+
+void verify_replay_files(const char* const* paths, int count, int thread_count, ReplayCheck* checks) {
+	if (thread_count <= 0) {
+		thread_count = SDL_GetCPUCount();
+	}
+	thread_count = MAX(1, MIN(thread_count, count));
+	VerifyJob job = { paths, checks, calloc(thread_count, sizeof(VerifyWorker)), thread_count };
+	VerifyThreadData* thread_data = malloc(sizeof(VerifyThreadData) * thread_count);
+	if (!job.workers || !thread_data) {
+		fprintf(stderr, "Error: Failed to allocate replay verifier workers, checking on one thread\n");
+		for (int i = 0; i < count; i++) {
+			verify_replay_file(paths[i], &checks[i]);
+		}
+		free(job.workers);
+		free(thread_data);
+		return;
+	}
+	for (int i = 0; i < thread_count; i++) {
+		job.workers[i].index = i;
+		job.workers[i].queue.next = (int)((Sint64)count * i / thread_count);
+		job.workers[i].queue.end = (int)((Sint64)count * (i + 1) / thread_count);
+	}
+	// Shares of threads that fail to start get stolen by the ones that did
+	for (int i = 1; i < thread_count; i++) {
+		thread_data[i] = (VerifyThreadData){ &job, &job.workers[i] };
+		job.workers[i].thread = SDL_CreateThread(verify_worker_thread, "ReplayVerifier", &thread_data[i]);
+	}
+	verify_worker_replays(&job, &job.workers[0]);
+	for (int i = 1; i < thread_count; i++) {
+		SDL_WaitThread(job.workers[i].thread, NULL);
+	}
+	free(job.workers);
+	free(thread_data);
+}
+
+// Paths are the only strings in the report, so they're the only thing that needs escaping
+static void write_json_string(FILE* file, const char* text) {
+	fputc('"', file);
+	for (const unsigned char* c = (const unsigned char*)text; *c; c++) {
+		if (*c == '"' || *c == '\\') {
+			fprintf(file, "\\%c", *c);
+		}
+		else if (*c < 0x20) {
+			fprintf(file, "\\u%04x", *c);
+		}
+		else {
+			fputc(*c, file);
+		}
+	}
+	fputc('"', file);
+}
+
+static void write_json_result(FILE* file, const char* name, const ReplayResult* result) {
+	fprintf(file, "\"%s\": { \"score\": %d, \"total_lines_cleared\": %d, \"elapsed_time\": %u }",
+		name, result->score, result->total_lines_cleared, result->elapsed_time);
+}
+
+bool write_replay_report(const char* path, const ReplayCheck* checks, int count) {
+	bool to_stdout = strcmp(path, "-") == 0;
+	FILE* file = to_stdout ? stdout : fopen(path, "w");
+	if (!file) {
+		fprintf(stderr, "Error: Failed to open %s to write the replay report\n", path);
+		return false;
+	}
+	int verdicts[VERIFY_INVALID + 1] = { 0 };
+	Uint64 steps = 0;
+	for (int i = 0; i < count; i++) {
+		verdicts[checks[i].verdict]++;
+		steps += checks[i].steps;
+	}
+	fprintf(file, "{\n");
+	fprintf(file, "  \"replays\": %d,\n  \"matched\": %d,\n  \"mismatched\": %d,\n  \"invalid\": %d,\n",
+		count, verdicts[VERIFY_MATCH], verdicts[VERIFY_MISMATCH], verdicts[VERIFY_INVALID]);
+	fprintf(file, "  \"steps\": %llu,\n  \"results\": [", (unsigned long long)steps);
+	for (int i = 0; i < count; i++) {
+		const ReplayCheck* check = &checks[i];
+		fprintf(file, "%s\n    { \"file\": ", i ? "," : "");
+		write_json_string(file, check->path);
+		fprintf(file, ", \"verdict\": \"%s\", \"steps\": %llu, ", get_verdict_name(check->verdict), (unsigned long long)check->steps);
+		write_json_result(file, "claimed", &check->claimed);
+		fprintf(file, ", ");
+		write_json_result(file, "simulated", &check->simulated);
+		fprintf(file, " }");
+	}
+	fprintf(file, "\n  ]\n}\n");
+	bool written = !ferror(file);
+	if (!to_stdout) {
+		written = fclose(file) == 0 && written;
+	}
+	if (!written) {
+		fprintf(stderr, "Error: Failed to write the replay report to %s\n", path);
+	}
+	return written;
+}
+
+bool run_replay_verifier(const char* const* paths, int count, int thread_count, const char* report_path) {
+	ReplayCheck* checks = malloc(sizeof(ReplayCheck) * MAX(1, count));
+	if (!checks) {
+		fprintf(stderr, "Error: Failed to allocate memory for %d replay checks\n", count);
+		return false;
+	}
+	Uint64 start = SDL_GetPerformanceCounter();
+	verify_replay_files(paths, count, thread_count, checks);
+	double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+	bool all_matched = write_replay_report(report_path, checks, count);
+	int matched = 0;
+	Uint64 steps = 0;
+	for (int i = 0; i < count; i++) {
+		matched += checks[i].verdict == VERIFY_MATCH;
+		steps += checks[i].steps;
+	}
+	all_matched = all_matched && matched == count;
+	// The summary goes to stderr so a report written to stdout stays valid JSON
+	fprintf(stderr, "Verified %d replays in %.2f s (%.0f steps/s): %d matched, %d did not\n",
+		count, seconds, seconds > 0 ? steps / seconds : 0.0, matched, count - matched);
+	free(checks);
+	return all_matched;
+}
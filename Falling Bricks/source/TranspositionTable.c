@@ -0,0 +1,91 @@
+#include "TranspositionTable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_TABLE_SIZE_BITS 30
+
+// Relaxed atomics where the compiler has them. Elsewhere aligned 64-bit accesses are at least whole on 64-bit targets,
+// and the key check catches any that aren't.
+static inline Uint64 load_entry_word(const Uint64* word) {
+#if defined(__GNUC__) || defined(__clang__)
+	return __atomic_load_n(word, __ATOMIC_RELAXED);
+#else
+	return *(const volatile Uint64*)word;
+#endif
+}
+
+static inline void store_entry_word(Uint64* word, Uint64 value) {
+#if defined(__GNUC__) || defined(__clang__)
+	__atomic_store_n(word, value, __ATOMIC_RELAXED);
+#else
+	*(volatile Uint64*)word = value;
+#endif
+}
+
+static inline void count(Uint64* counter) {
+#if defined(__GNUC__) || defined(__clang__)
+	__atomic_fetch_add(counter, 1, __ATOMIC_RELAXED);
+#elif defined(_MSC_VER)
+	_InterlockedIncrement64((volatile __int64*)counter);
+#else
+	(*counter)++;
+#endif
+}
+
+TranspositionTable* create_transposition_table(int size_bits) {
+	if (size_bits < 0 || size_bits > MAX_TABLE_SIZE_BITS) {
+		fprintf(stderr, "Error: Transposition table size must be between 2^0 and 2^%d entries\n", MAX_TABLE_SIZE_BITS);
+		return NULL;
+	}
+	TranspositionTable* table = malloc(sizeof(TranspositionTable));
+	if (!table) {
+		fprintf(stderr, "Error: Failed to allocate memory for TranspositionTable\n");
+		return NULL;
+	}
+	Uint64 entry_count = (Uint64)1 << size_bits;
+	table->entries = calloc((size_t)entry_count, sizeof(TranspositionEntry));
+	if (!table->entries) {
+		fprintf(stderr, "Error: Failed to allocate %llu transposition table entries\n", (unsigned long long)entry_count);
+		free(table);
+		return NULL;
+	}
+	table->mask = entry_count - 1;
+	table->hits = 0;
+	table->misses = 0;
+	table->stores = 0;
+	return table;
+}
+
+bool probe_transposition_table(TranspositionTable* table, Uint64 key, Uint64* data) {
+	TranspositionEntry* entry = &table->entries[key & table->mask];
+	Uint64 check = load_entry_word(&entry->check);
+	Uint64 entry_data = load_entry_word(&entry->data);
+	if ((check ^ entry_data) != key) {
+		count(&table->misses);
+		return false;
+	}
+	count(&table->hits);
+	*data = entry_data;
+	return true;
+}
+
+void store_transposition_table(TranspositionTable* table, Uint64 key, Uint64 data) {
+	TranspositionEntry* entry = &table->entries[key & table->mask];
+	store_entry_word(&entry->check, key ^ data);
+	store_entry_word(&entry->data, data);
+	count(&table->stores);
+}
+
+void clear_transposition_table(TranspositionTable* table) {
+	memset(table->entries, 0, sizeof(TranspositionEntry) * (size_t)(table->mask + 1));
+	table->hits = 0;
+	table->misses = 0;
+	table->stores = 0;
+}
+
+void destroy_transposition_table(TranspositionTable* table) {
+	if (!table) return;
+	free(table->entries);
+	free(table);
+}